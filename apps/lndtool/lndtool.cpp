@@ -7,10 +7,13 @@
  * openblack is licensed under the GNU General Public License version 3.
  *****************************************************************************/
 
+#include <LNDCookedFile.h>
 #include <LNDFile.h>
+#include <LNDFileView.h>
 
 #include <cstdlib>
 #include <cxxopts.hpp>
+#include <filesystem>
 #include <fstream>
 #include <string>
 
@@ -326,6 +329,7 @@ struct Arguments
 		Extra,
 		Unaccounted,
 		Write,
+		Cook,
 	};
 	Mode mode;
 	struct Read
@@ -340,6 +344,11 @@ struct Arguments
 		std::string bumpMapFile;
 		std::vector<std::string> materialArray;
 	} write;
+	struct Cook
+	{
+		std::string inFilename;
+		std::string outFilename;
+	} cook;
 };
 
 int WriteFile(const Arguments::Write& args)
@@ -444,6 +453,25 @@ int WriteFile(const Arguments::Write& args)
 	return EXIT_SUCCESS;
 }
 
+int CookFile(const Arguments::Cook& args)
+{
+	try
+	{
+		openblack::lnd::LNDFileView lnd;
+		lnd.Open(args.inFilename);
+
+		openblack::lnd::LNDCookedFile cooked;
+		cooked.Cook(lnd, args.outFilename);
+	}
+	catch (std::runtime_error& err)
+	{
+		std::cerr << err.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
 bool parseOptions(int argc, char** argv, Arguments& args, int& return_code)
 {
 	cxxopts::Options options("lndtool", "Inspect and extract files from LionHead LND files.");
@@ -453,7 +481,7 @@ bool parseOptions(int argc, char** argv, Arguments& args, int& return_code)
 		("h,help", "Display this help message.")
 		("subcommand", "Subcommand.", cxxopts::value<std::string>())
 	;
-	options.positional_help("[read|write] [OPTION...]");
+	options.positional_help("[read|write|cook] [OPTION...]");
 	options.add_options("read")
 		("H,header", "Print Header Contents.", cxxopts::value<std::vector<std::string>>())
 		("l,low-resolution-textures", "Print Low Resolution Texture Contents.", cxxopts::value<std::vector<std::string>>())
@@ -470,6 +498,9 @@ bool parseOptions(int argc, char** argv, Arguments& args, int& return_code)
 		("bump-map", "File with R8 bytes for bump map.", cxxopts::value<std::string>())
 		("material-array", "Files with RGB5A1 bytes for material array (comma-separated).", cxxopts::value<std::vector<std::string>>())
 	;
+	options.add_options("cook")
+		("i,input", "LND file to cook (required), output defaults to it with a .lndc extension.", cxxopts::value<std::string>())
+	;
 	// clang-format on
 
 	options.parse_positional({"subcommand"});
@@ -557,6 +588,19 @@ bool parseOptions(int argc, char** argv, Arguments& args, int& return_code)
 				return true;
 			}
 		}
+		else if (result["subcommand"].as<std::string>() == "cook")
+		{
+			if (result["input"].count() > 0)
+			{
+				args.mode = Arguments::Mode::Cook;
+				args.cook.inFilename = result["input"].as<std::string>();
+				// the game looks for the cooked file next to the LND
+				args.cook.outFilename = result["output"].count() > 0
+				                            ? result["output"].as<std::string>()
+				                            : std::filesystem::path(args.cook.inFilename).replace_extension(".lndc").string();
+				return true;
+			}
+		}
 	}
 	catch (cxxopts::OptionParseException& err)
 	{
@@ -582,6 +626,11 @@ int main(int argc, char* argv[])
 		return WriteFile(args.write);
 	}
 
+	if (args.mode == Arguments::Mode::Cook)
+	{
+		return CookFile(args.cook);
+	}
+
 	for (auto& filename : args.read.filenames)
 	{
 		openblack::lnd::LNDFile lnd;
@@ -9,10 +9,16 @@
 
 #include <PackFile.h>
 
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
 #include <cstdlib>
 #include <cxxopts.hpp>
 #include <fstream>
+#include <map>
 #include <string>
+#include <thread>
 
 int PrintRawBytes(const void* data, std::size_t size)
 {
@@ -58,7 +64,7 @@ int ListBlocks(openblack::pack::PackFile& pack)
 	uint32_t i = 0;
 	for (auto& [name, data] : blocks)
 	{
-		std::printf("%u: name \"%s\", size %u\n", ++i, name.c_str(), static_cast<uint32_t>(data.size()));
+		std::printf("%u: name \"%s\", size %u\n", ++i, name, static_cast<uint32_t>(data.size()));
 	}
 	std::printf("\n");
 
@@ -67,7 +73,7 @@ int ListBlocks(openblack::pack::PackFile& pack)
 
 int ViewBytes(openblack::pack::PackFile& pack, const std::string& name)
 {
-	auto& block = pack.GetBlock(name);
+	auto block = pack.GetBlock(name);
 
 	std::printf("file: %s, block %s\n", pack.GetFilename().c_str(), name.c_str());
 
@@ -142,9 +148,10 @@ int ViewAnimations(openblack::pack::PackFile& pack)
 	std::printf("file: %s\n", pack.GetFilename().c_str());
 
 	uint32_t i = 0;
-	for (auto& animation : animations)
+	for (auto& [header, body] : animations)
 	{
-		std::printf("animation #%-5d %-32s size %u\n", i++, animation.data(), static_cast<uint32_t>(animation.size()));
+		std::printf("animation #%-5d %-32s size %u\n", i++, reinterpret_cast<const char*>(header.data()),
+		            static_cast<uint32_t>(header.size() + body.size()));
 	}
 
 	return EXIT_SUCCESS;
@@ -202,12 +209,12 @@ int ViewTexture(openblack::pack::PackFile& pack, const std::string& name, const
 
 int ViewMesh(openblack::pack::PackFile& pack, uint32_t index, const std::string& outFilename)
 {
-	if (index > pack.GetMeshes().size())
+	if (index >= pack.GetMeshes().size())
 	{
 		return EXIT_FAILURE;
 	}
 
-	auto& mesh = pack.GetMesh(index);
+	auto mesh = pack.GetMesh(index);
 
 	std::printf("file: %s\n", pack.GetFilename().c_str());
 	std::printf("mesh: %u bytes\n", static_cast<uint32_t>(mesh.size()));
@@ -225,20 +232,22 @@ int ViewMesh(openblack::pack::PackFile& pack, uint32_t index, const std::string&
 
 int ViewAnimation(openblack::pack::PackFile& pack, uint32_t index, const std::string& outFilename)
 {
-	if (index > pack.GetAnimations().size())
+	if (index >= pack.GetAnimations().size())
 	{
 		return EXIT_FAILURE;
 	}
 
-	const auto& animation = pack.GetAnimation(index);
+	const auto& [header, body] = pack.GetAnimation(index);
 
 	std::printf("file: %s\n", pack.GetFilename().c_str());
-	std::printf("animation: %-32s %u bytes\n", animation.data(), static_cast<uint32_t>(animation.size()));
+	std::printf("animation: %-32s %u bytes\n", reinterpret_cast<const char*>(header.data()),
+	            static_cast<uint32_t>(header.size() + body.size()));
 
 	if (!outFilename.empty())
 	{
 		std::ofstream output(outFilename, std::ios::binary);
-		output.write(reinterpret_cast<const char*>(animation.data()), animation.size() * sizeof(animation[0]));
+		output.write(reinterpret_cast<const char*>(header.data()), header.size() * sizeof(header[0]));
+		output.write(reinterpret_cast<const char*>(body.data()), body.size() * sizeof(body[0]));
 
 		std::printf("\nANM file writen to %s\n", outFilename.c_str());
 	}
@@ -246,26 +255,351 @@ int ViewAnimation(openblack::pack::PackFile& pack, uint32_t index, const std::st
 	return EXIT_SUCCESS;
 }
 
-int WriteMeshFile(const std::string& outFilename)
+int Benchmark(const std::string& filename)
 {
-	openblack::pack::PackFile pack;
+	using openblack::pack::PackOpenFlags;
+	using Seconds = std::chrono::duration<double>;
+	constexpr uint32_t iterations = 5;
+
+	std::size_t totalSize = 0;
+	// Best of a few runs after a warm-up, so that both modes read from the page cache
+	auto time = [&filename, &totalSize](PackOpenFlags flags) {
+		Seconds best = Seconds::max();
+		for (uint32_t i = 0; i < iterations + 1; ++i)
+		{
+			openblack::pack::PackFile pack;
+			const auto start = std::chrono::steady_clock::now();
+			pack.Open(filename, flags);
+			const Seconds elapsed = std::chrono::steady_clock::now() - start;
+			if (i > 0)
+			{
+				best = std::min(best, elapsed);
+			}
+
+			totalSize = 0;
+			for (auto& [name, data] : pack.GetBlocks())
+			{
+				totalSize += data.size();
+			}
+		}
+		return best;
+	};
 
-	// TODO(bwrsandman): expand on this to create files with contents
-	// CreateTextureBlocks();  // TODO(bwrsandman): Implement CreateTextureBlocks
-	pack.CreateMeshBlock();
-	pack.CreateInfoBlock();
-	pack.Write(outFilename);
+	const auto serial = time(PackOpenFlags::MemoryMap);
+	const auto parallel = time(PackOpenFlags::MemoryMap | PackOpenFlags::Parallel);
+	const auto megabytes = static_cast<double>(totalSize) / (1024.0 * 1024.0);
+
+	std::printf("file: %s\n", filename.c_str());
+	std::printf("size: %.2f MB\n", megabytes);
+	std::printf("serial:   %8.3f ms, %9.2f MB/s\n", serial.count() * 1000.0, megabytes / serial.count());
+	std::printf("parallel: %8.3f ms, %9.2f MB/s (%u threads)\n", parallel.count() * 1000.0, megabytes / parallel.count(),
+	            std::thread::hardware_concurrency());
 
 	return EXIT_SUCCESS;
 }
 
-int WriteAnimationFile(const std::string& outFilename)
+bool HasExtension(const std::string& filename, const std::string& extension)
+{
+	if (filename.size() < extension.size())
+	{
+		return false;
+	}
+	return std::equal(extension.rbegin(), extension.rend(), filename.rbegin(),
+	                  [](char a, char b) { return std::tolower(a) == std::tolower(b); });
+}
+
+/// Id of a texture from its dds file, named after the id in hexadecimal like the texture block it was extracted from
+bool GetTextureId(const std::string& filename, uint32_t& id)
+{
+	const auto slash = filename.find_last_of("/\\");
+	const auto start = slash == std::string::npos ? 0 : slash + 1;
+	const auto stem = filename.substr(start, filename.size() - start - std::string(".dds").size());
+	const auto isHex = [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; };
+	if (stem.empty() || stem.size() > 8 || !std::all_of(stem.begin(), stem.end(), isHex))
+	{
+		return false;
+	}
+	id = static_cast<uint32_t>(std::strtoul(stem.c_str(), nullptr, 16));
+	// Texture ids start at 1 - 0 would be an error texture
+	return id != 0;
+}
+
+std::size_t GetStreamSize(std::istream& stream)
+{
+	stream.seekg(0, std::ios_base::end);
+	auto size = static_cast<std::size_t>(stream.tellg());
+	stream.seekg(0);
+	return size;
+}
+
+/// 64-bit FNV-1a of the contents of a stream, read in chunks
+uint64_t HashStream(std::istream& stream)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+	std::array<char, 0x10000> buffer;
+	while (stream.read(buffer.data(), buffer.size()) || stream.gcount() > 0)
+	{
+		for (std::streamsize i = 0; i < stream.gcount(); ++i)
+		{
+			hash ^= static_cast<uint8_t>(buffer[i]);
+			hash *= 0x100000001b3;
+		}
+	}
+	return hash;
+}
+
+bool FilesEqual(const std::string& a, const std::string& b)
+{
+	std::ifstream streamA(a, std::ios::binary);
+	std::ifstream streamB(b, std::ios::binary);
+	std::array<char, 0x10000> bufferA;
+	std::array<char, 0x10000> bufferB;
+	while (streamA && streamB)
+	{
+		streamA.read(bufferA.data(), bufferA.size());
+		streamB.read(bufferB.data(), bufferB.size());
+		if (streamA.gcount() != streamB.gcount() ||
+		    !std::equal(bufferA.begin(), bufferA.begin() + streamA.gcount(), bufferB.begin()))
+		{
+			return false;
+		}
+	}
+	return !streamA && !streamB;
+}
+
+/// Index of the first identical earlier file for every file, or its own index when it is the first of its contents
+std::vector<uint32_t> FindDuplicates(const std::vector<std::string>& filenames, std::vector<std::size_t>& sizes)
+{
+	std::map<std::pair<std::size_t, uint64_t>, std::vector<uint32_t>> firstByContents;
+	std::vector<uint32_t> originals(filenames.size());
+	sizes.resize(filenames.size());
+	for (uint32_t i = 0; i < filenames.size(); ++i)
+	{
+		std::ifstream input(filenames[i], std::ios::binary);
+		sizes[i] = GetStreamSize(input);
+		auto& candidates = firstByContents[{sizes[i], HashStream(input)}];
+
+		originals[i] = i;
+		for (auto candidate : candidates)
+		{
+			// Don't trust the hash alone
+			if (FilesEqual(filenames[candidate], filenames[i]))
+			{
+				originals[i] = candidate;
+				break;
+			}
+		}
+		if (originals[i] == i)
+		{
+			candidates.push_back(i);
+		}
+	}
+	return originals;
+}
+
+int WriteMeshFile(const std::string& outFilename, const std::vector<std::string>& inputFilenames, bool deduplicate)
 {
-	openblack::pack::PackFile pack;
+	using namespace openblack::pack;
+
+	std::vector<std::string> meshFilenames;
+	// Meshes' skins refer to textures by id, so each id comes from its file name rather than the argument order
+	std::map<uint32_t, std::string> texturesById;
+	for (auto& filename : inputFilenames)
+	{
+		if (HasExtension(filename, ".l3d"))
+		{
+			meshFilenames.push_back(filename);
+		}
+		else if (HasExtension(filename, ".dds"))
+		{
+			uint32_t id;
+			if (!GetTextureId(filename, id))
+			{
+				std::cerr << "Texture " << filename << " is not named after its id in hexadecimal, e.g. 1a.dds" << std::endl;
+				return EXIT_FAILURE;
+			}
+			auto inserted = texturesById.emplace(id, filename);
+			if (!inserted.second)
+			{
+				std::cerr << "Textures " << inserted.first->second << " and " << filename << " have the same id" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else
+		{
+			std::cerr << "Unsupported mesh pack input " << filename << ", expected .l3d or .dds" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Textures are written in id order
+	std::vector<std::string> textureFilenames;
+	std::vector<InfoBlockLookup> lookup;
+	for (const auto& [id, filename] : texturesById)
+	{
+		textureFilenames.push_back(filename);
+		lookup.push_back({id, 0});
+	}
 
-	// TODO(bwrsandman): expand on this to create files with contents
-	pack.CreateBodyBlock();
-	pack.Write(outFilename);
+	// Identical meshes can share their offset in the MESHES block as l3d meshes know their own size
+	std::vector<uint32_t> meshOriginals(meshFilenames.size());
+	if (deduplicate)
+	{
+		std::vector<std::size_t> meshSizes;
+		meshOriginals = FindDuplicates(meshFilenames, meshSizes);
+
+		std::size_t savedBytes = 0;
+		uint32_t duplicates = 0;
+		for (uint32_t i = 0; i < meshOriginals.size(); ++i)
+		{
+			if (meshOriginals[i] != i)
+			{
+				savedBytes += meshSizes[i];
+				++duplicates;
+			}
+		}
+		std::printf("%u duplicate meshes, %zu bytes saved\n", duplicates, savedBytes);
+
+		// Textures are addressed by id in both the INFO block and the meshes' skins, so duplicates can only be reported
+		std::vector<std::size_t> textureSizes;
+		auto textureOriginals = FindDuplicates(textureFilenames, textureSizes);
+		std::size_t duplicateTextureBytes = 0;
+		duplicates = 0;
+		for (uint32_t i = 0; i < textureOriginals.size(); ++i)
+		{
+			if (textureOriginals[i] != i)
+			{
+				duplicateTextureBytes += textureSizes[i];
+				++duplicates;
+				std::printf("texture %s duplicates %s, kept as its id may be referenced\n", textureFilenames[i].c_str(),
+				            textureFilenames[textureOriginals[i]].c_str());
+			}
+		}
+		std::printf("%u duplicate textures, %zu bytes kept\n", duplicates, duplicateTextureBytes);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < meshOriginals.size(); ++i)
+		{
+			meshOriginals[i] = i;
+		}
+	}
+
+	std::ofstream output(outFilename, std::ios::binary);
+	if (!output.is_open())
+	{
+		std::cerr << "Could not open " << outFilename << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// Every input is copied straight into the pack, only one chunk is held in memory at a time
+	PackWriter writer(output);
+
+	writer.WriteInfoBlock(lookup);
+
+	for (uint32_t i = 0; i < textureFilenames.size(); ++i)
+	{
+		std::ifstream input(textureFilenames[i], std::ios::binary);
+		char magic[4];
+		DdsHeader ddsHeader;
+		input.read(magic, sizeof(magic));
+		input.read(reinterpret_cast<char*>(&ddsHeader), sizeof(ddsHeader));
+		if (!input || std::string(magic, sizeof(magic)) != "DDS ")
+		{
+			std::cerr << "Could not read dds header of " << textureFilenames[i] << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		G3DTextureHeader header;
+		const auto fourCC = std::string(ddsHeader.format.fourCC, sizeof(ddsHeader.format.fourCC));
+		if (fourCC == "DXT1")
+		{
+			header.type = 1;
+		}
+		else if (fourCC == "DXT3")
+		{
+			header.type = 2;
+		}
+		else
+		{
+			std::cerr << "Unsupported texture format " << fourCC << " in " << textureFilenames[i] << std::endl;
+			return EXIT_FAILURE;
+		}
+		header.id = lookup[i].blockId;
+		header.size = static_cast<uint32_t>(sizeof(ddsHeader)) + ddsHeader.pitchOrLinearSize;
+		header.ddsSize = static_cast<uint32_t>(sizeof(uint32_t) + sizeof(ddsHeader)) + ddsHeader.pitchOrLinearSize;
+
+		writer.WriteTextureBlock(header, ddsHeader, input);
+	}
+
+	writer.BeginMeshBlock(static_cast<uint32_t>(meshFilenames.size()));
+	for (uint32_t i = 0; i < meshFilenames.size(); ++i)
+	{
+		if (meshOriginals[i] != i)
+		{
+			writer.AddMeshReference(meshOriginals[i]);
+			continue;
+		}
+
+		std::ifstream input(meshFilenames[i], std::ios::binary);
+		if (!input.is_open())
+		{
+			std::cerr << "Could not open " << meshFilenames[i] << std::endl;
+			return EXIT_FAILURE;
+		}
+		writer.AddMesh(input, GetStreamSize(input));
+	}
+	writer.EndMeshBlock();
+
+	std::printf("Mesh pack with %u textures and %u meshes written to %s\n", static_cast<uint32_t>(textureFilenames.size()),
+	            static_cast<uint32_t>(meshFilenames.size()), outFilename.c_str());
+
+	return EXIT_SUCCESS;
+}
+
+int WriteAnimationFile(const std::string& outFilename, const std::vector<std::string>& inputFilenames)
+{
+	using namespace openblack::pack;
+	constexpr uint32_t animationHeaderSize = 0x54;
+
+	// Headers all go in the Body block, read them first. The keyframes are copied in a second pass.
+	std::vector<std::array<uint8_t, animationHeaderSize>> headers(inputFilenames.size());
+	std::vector<openblack::Span<uint8_t>> headerSpans;
+	for (uint32_t i = 0; i < inputFilenames.size(); ++i)
+	{
+		std::ifstream input(inputFilenames[i], std::ios::binary);
+		input.read(reinterpret_cast<char*>(headers[i].data()), headers[i].size());
+		if (!input)
+		{
+			std::cerr << "Could not read anm header of " << inputFilenames[i] << std::endl;
+			return EXIT_FAILURE;
+		}
+		headerSpans.emplace_back(headers[i].data(), headers[i].size());
+	}
+
+	std::ofstream output(outFilename, std::ios::binary);
+	if (!output.is_open())
+	{
+		std::cerr << "Could not open " << outFilename << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	PackWriter writer(output);
+	writer.WriteBodyBlock(headerSpans);
+
+	for (uint32_t i = 0; i < inputFilenames.size(); ++i)
+	{
+		std::ifstream input(inputFilenames[i], std::ios::binary);
+		const auto size = GetStreamSize(input);
+		input.seekg(animationHeaderSize);
+
+		writer.BeginBlock("Julien" + std::to_string(i));
+		writer.Write(input, size - animationHeaderSize);
+		writer.EndBlock();
+	}
+
+	std::printf("Animation pack with %u animations written to %s\n", static_cast<uint32_t>(inputFilenames.size()),
+	            outFilename.c_str());
 
 	return EXIT_SUCCESS;
 }
@@ -284,6 +618,7 @@ struct Arguments
 		Mesh,
 		Animation,
 		Body,
+		Benchmark,
 		WriteMeshPack,
 		WriteAnimationPack,
 	};
@@ -292,6 +627,8 @@ struct Arguments
 	std::string block;
 	uint32_t blockId;
 	std::string outFilename;
+	bool deduplicate;
+	bool parallel;
 };
 
 bool parseOptions(int argc, char** argv, Arguments& args, int& return_code)
@@ -312,8 +649,11 @@ bool parseOptions(int argc, char** argv, Arguments& args, int& return_code)
 		("A,animation-block", "List animation block statistics.")
 		("a,animation", "List animation statistics.", cxxopts::value<uint32_t>())
 		("e,extract", "Extract contents of a block to filename.", cxxopts::value<std::string>())
-		("write-mesh", "Create Mesh Pack.", cxxopts::value<std::string>())
-		("write-animation", "Create Mesh Pack.", cxxopts::value<std::string>())
+		("benchmark", "Time serial and parallel extraction of textures and meshes.")
+		("parallel", "Extract all textures and meshes over all hardware threads.")
+		("write-mesh", "Create Mesh Pack from the l3d meshes and dds textures given as positional arguments, textures named <hex id>.dds.", cxxopts::value<std::string>())
+		("dedup", "Share the data of identical meshes when creating a Mesh Pack and report duplicate textures.")
+		("write-animation", "Create Animation Pack from the anm files given as positional arguments.", cxxopts::value<std::string>())
 		("pack-files", "Pack Files.", cxxopts::value<std::vector<std::string>>())
 	;
 	// clang-format on
@@ -324,6 +664,8 @@ bool parseOptions(int argc, char** argv, Arguments& args, int& return_code)
 	{
 		auto result = options.parse(argc, argv);
 		args.outFilename = "";
+		args.deduplicate = result["dedup"].count() > 0;
+		args.parallel = result["parallel"].count() > 0;
 		if (result["help"].as<bool>())
 		{
 			std::cout << options.help() << std::endl;
@@ -334,12 +676,20 @@ bool parseOptions(int argc, char** argv, Arguments& args, int& return_code)
 		{
 			args.mode = Arguments::Mode::WriteMeshPack;
 			args.outFilename = result["write-mesh"].as<std::string>();
+			if (result["pack-files"].count() > 0)
+			{
+				args.filenames = result["pack-files"].as<std::vector<std::string>>();
+			}
 			return true;
 		}
 		if (result["write-animation"].count() > 0)
 		{
 			args.mode = Arguments::Mode::WriteAnimationPack;
 			args.outFilename = result["write-animation"].as<std::string>();
+			if (result["pack-files"].count() > 0)
+			{
+				args.filenames = result["pack-files"].as<std::vector<std::string>>();
+			}
 			return true;
 		}
 		// Following this, all args require positional arguments
@@ -347,6 +697,12 @@ bool parseOptions(int argc, char** argv, Arguments& args, int& return_code)
 		{
 			throw cxxopts::missing_argument_exception("pack-files");
 		}
+		if (result["benchmark"].count() > 0)
+		{
+			args.mode = Arguments::Mode::Benchmark;
+			args.filenames = result["pack-files"].as<std::vector<std::string>>();
+			return true;
+		}
 		if (result["list-blocks"].count() > 0)
 		{
 			args.mode = Arguments::Mode::List;
@@ -443,14 +799,60 @@ int main(int argc, char* argv[])
 		return return_code;
 	}
 
-	if (args.mode == Arguments::Mode::WriteMeshPack)
+	try
 	{
-		return WriteMeshFile(args.outFilename);
+		if (args.mode == Arguments::Mode::WriteMeshPack)
+		{
+			return WriteMeshFile(args.outFilename, args.filenames, args.deduplicate);
+		}
+
+		if (args.mode == Arguments::Mode::WriteAnimationPack)
+		{
+			return WriteAnimationFile(args.outFilename, args.filenames);
+		}
+	}
+	catch (std::runtime_error& err)
+	{
+		std::cerr << err.what() << std::endl;
+		return EXIT_FAILURE;
 	}
 
-	if (args.mode == Arguments::Mode::WriteAnimationPack)
+	if (args.mode == Arguments::Mode::Benchmark)
 	{
-		return WriteAnimationFile(args.outFilename);
+		for (auto& filename : args.filenames)
+		{
+			try
+			{
+				return_code |= Benchmark(filename);
+			}
+			catch (std::runtime_error& err)
+			{
+				std::cerr << err.what() << std::endl;
+				return_code |= EXIT_FAILURE;
+			}
+		}
+		return return_code;
+	}
+
+	// Map file, nothing is modified so every view can point into the mapping
+	auto flags = openblack::pack::PackOpenFlags::MemoryMap;
+	// Modes looking at a single entry don't need to extract every other one
+	switch (args.mode)
+	{
+	case Arguments::Mode::Bytes:
+	case Arguments::Mode::Info:
+	case Arguments::Mode::Body:
+	case Arguments::Mode::Texture:
+	case Arguments::Mode::Mesh:
+	case Arguments::Mode::Animation:
+		flags = flags | openblack::pack::PackOpenFlags::Lazy;
+		break;
+	default:
+		if (args.parallel)
+		{
+			flags = flags | openblack::pack::PackOpenFlags::Parallel;
+		}
+		break;
 	}
 
 	for (auto& filename : args.filenames)
@@ -459,7 +861,7 @@ int main(int argc, char* argv[])
 		try
 		{
 			// Open file
-			pack.Open(filename);
+			pack.Open(filename, flags);
 
 			switch (args.mode)
 			{
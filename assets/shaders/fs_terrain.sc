@@ -12,7 +12,7 @@ uniform vec4 u_smallBumpmapStrength;
 
 void main()
 {
-	// do each vert with both materials
+	// do each corner with both materials, the corner opposite to this triangle has no weight
 	vec4 colOne = mix(
 		texture2DArray(s0_materials, vec3(v_texcoord0.xy, v_materialID0.r)),
 		texture2DArray(s0_materials, vec3(v_texcoord0.xy, v_materialID1.r)),
@@ -28,9 +28,14 @@ void main()
 		texture2DArray(s0_materials, vec3(v_texcoord0.xy, v_materialID1.b)),
 		v_materialBlend.b
 	) * v_weight.b;
-
-	// add the 3 blended textures together
-	vec4 col = colOne + colTwo + colThree;
+	vec4 colFour = mix(
+		texture2DArray(s0_materials, vec3(v_texcoord0.xy, v_materialID0.a)),
+		texture2DArray(s0_materials, vec3(v_texcoord0.xy, v_materialID1.a)),
+		v_materialBlend.a
+	) * v_weight.a;
+
+	// add the 4 blended textures together
+	vec4 col = colOne + colTwo + colThree + colFour;
 
 	// apply bump map (2x because it's half bright?)
 	float bump = mix(1.0f, texture2D(s1_bump, v_texcoord0.xy).r * 2, u_bumpmapStrength.r);
@@ -0,0 +1,30 @@
+$input v_texcoord0, v_texcoord1, v_lightLevel, v_waterAlpha
+
+#include <bgfx_shader.sh>
+
+// Materials of every block blended by LandIsland, drawn instead of fs_terrain past the bake distance
+SAMPLER2D(s1_bump, 1);
+SAMPLER2D(s7_baked, 7);
+
+uniform vec4 u_timeOfDay;
+uniform vec4 u_bumpmapStrength;
+
+void main()
+{
+	vec4 col = texture2D(s7_baked, v_texcoord1.xy);
+
+	// apply bump map (2x because it's half bright?)
+	float bump = mix(1.0f, texture2D(s1_bump, v_texcoord0.xy).r * 2, u_bumpmapStrength.r);
+	col = col * bump;
+
+	// the small bump map is only applied close to the camera, never this far
+
+	// apply light map
+	col = col * mix(.25f, clamp(v_lightLevel * 2, 0.5, 1), u_timeOfDay.r);
+
+	gl_FragColor = vec4(col.rgb, v_waterAlpha);
+
+	if (v_waterAlpha == 0.0) {
+		discard;
+	}
+}
@@ -1,16 +1,12 @@
-$input a_position, a_color0, i_data0, i_data1, i_data2, i_data3, i_data4
+$input a_position, a_color0, i_data0, i_data1, i_data2
 $output v_color0
 
 #include <bgfx_shader.sh>
 
 void main()
 {
-	mat4 model;
-	model[0] = i_data0;
-	model[1] = i_data1;
-	model[2] = i_data2;
-	model[3] = i_data3;
-
-	gl_Position = mul(u_viewProj, instMul(model, a_position));
+	// the instance data holds the upper three rows of the affine model matrix, see AffineMatrix
+	vec4 position = vec4(dot(i_data0, a_position), dot(i_data1, a_position), dot(i_data2, a_position), 1.0f);
+	gl_Position = mul(u_viewProj, position);
 	v_color0 = a_color0;
 }
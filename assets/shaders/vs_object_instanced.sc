@@ -1,4 +1,4 @@
-$input a_position, a_texcoord0, a_normal, a_indices, i_data0, i_data1, i_data2, i_data3, i_data4
+$input a_position, a_texcoord0, a_normal, a_indices, i_data0, i_data1, i_data2
 $output v_position, v_texcoord0, v_normal
 
 #if BGFX_SHADER_LANGUAGE_HLSL == 3
@@ -18,13 +18,9 @@ void main()
 	uint modelIndex = uint(max(0, a_indices.x));
 #endif
 
-	mat4 model;
-	model[0] = i_data0;
-	model[1] = i_data1;
-	model[2] = i_data2;
-	model[3] = i_data3;
-
-	v_position = instMul(model, mul(u_model[modelIndex], vec4(a_position.xyz, 1.0f)));
+	// the instance data holds the upper three rows of the affine model matrix, see AffineMatrix
+	vec4 position = mul(u_model[modelIndex], vec4(a_position.xyz, 1.0f));
+	v_position = vec4(dot(i_data0, position), dot(i_data1, position), dot(i_data2, position), 1.0f);
 	v_texcoord0 = vec4(a_texcoord0, 0.0f, 0.0f);
 	v_normal = a_normal;
 	gl_Position = mul(u_viewProj, v_position);
@@ -1,27 +1,94 @@
-$input a_position, a_texcoord1, a_color1, a_color2, a_texcoord2, a_color0, a_color3
+$input a_position, a_color0
 $output v_texcoord0, v_weight, v_materialID0, v_materialID1, v_materialBlend, v_lightLevel, v_waterAlpha, v_distToCamera
 
 #include <bgfx_shader.sh>
 
-#if BGFX_SHADER_LANGUAGE_HLSL > 3
-#   define materialIdFix(x) (floatBitsToInt(x))
-#else
-#   define materialIdFix(x) (ivec3(x))
-#endif
+// LandIsland::CellSize, LandIsland::HeightUnit and LandIsland::GridSize
+#define CELL_SIZE 10.0f
+#define HEIGHT_UNIT 0.67f
+#define GRID_SIZE 513.0f
 
-uniform vec4 u_blockPosition;
+// One texel per cell of the island grid, x along the rows like LandIsland::GridIndex
+SAMPLER2D(s3_altitudes, 3);
+SAMPLER2D(s4_cellProperties, 4);
+// 256x256, repeated over the grid
+SAMPLER2D(s5_noise, 5);
+// Both material ids and the blend coefficient for every country (row) and altitude plus noise (column)
+SAMPLER2D(s6_countryLookup, 6);
+
+// Four blocks per vec4 in the order of LandIsland::GetBlocks, each one packed as
+// blockX + 32 * blockZ + 1024 * edges, edges having a bit for each edge (-x, +x, -z, +z) whose neighbour uses the next
+// coarser level of detail
+uniform vec4 u_blockData[64];
+
+// Normalized bytes back to their integer value
+vec4 bytes(vec4 normalized)
+{
+	return floor(normalized * 255.0f + 0.5f);
+}
+
+// First material id, second material id and blend coefficient of a grid cell, as LandBlock used to look them up
+vec3 cellMaterial(vec2 cell)
+{
+	vec2 gridUv = (cell.yx + 0.5f) / GRID_SIZE;
+	float altitude = bytes(texture2DLod(s3_altitudes, gridUv, 0.0f)).x;
+	float country = mod(bytes(texture2DLod(s4_cellProperties, gridUv, 0.0f)).x, 16.0f);
+	float noise = bytes(texture2DLod(s5_noise, (mod(cell.yx, vec2_splat(256.0f)) + 0.5f) / 256.0f, 0.0f)).x;
+	vec2 lookupUv = vec2((min(altitude + noise, 255.0f) + 0.5f) / 256.0f, (country + 0.5f) / 16.0f);
+	return bytes(texture2DLod(s6_countryLookup, lookupUv, 0.0f)).xyz;
+}
 
 void main()
 {
-	v_texcoord0 = vec4(a_position.z / 160.0f, a_position.x / 160.0f, 0.0f, 0.0f);
-	v_weight = a_texcoord1;
-	v_materialID0 = materialIdFix(a_color1);
-	v_materialID1 = materialIdFix(a_color2);
-	v_materialBlend = a_texcoord2;
-	v_lightLevel = a_color0.x;
-	v_waterAlpha = a_color3;
-
-	vec3 transformedPosition = vec3(a_position.x + u_blockPosition.x, a_position.y, a_position.z + u_blockPosition.y);
+	// x, altitude and z within the block and the index of the block
+	vec4 position = bytes(a_position);
+	// light level, water alpha, low byte of the stitch altitude and the packed corner, see LandVertex
+	vec4 color = bytes(a_color0);
+
+	// pick the component of the block out of the array
+	float blockIndex = position.w;
+	float blockSlot = mod(blockIndex, 4.0f);
+	vec4 blockMask = vec4_splat(1.0f) - min(abs(vec4_splat(blockSlot) - vec4(0.0f, 1.0f, 2.0f, 3.0f)), vec4_splat(1.0f));
+	float blockData = dot(u_blockData[int(blockIndex * 0.25f)], blockMask);
+	float edges = floor(blockData / 1024.0f);
+	float blockZ = floor((blockData - edges * 1024.0f) / 32.0f);
+	float blockX = blockData - edges * 1024.0f - blockZ * 32.0f;
+	vec4 blockStitch = mod(floor(vec4_splat(edges) / vec4(1.0f, 2.0f, 4.0f, 8.0f)), vec4_splat(2.0f));
+
+	// weight corner in the lowest 2 bits, the 9th bit of the stitch altitude and the level of detail above them
+	float lod = floor(color.w / 8.0f);
+	float stitchHigh = mod(floor(color.w / 4.0f), 2.0f);
+	float corner = mod(color.w, 4.0f);
+
+	// vertices on a stitched edge take the altitude of the coarser edge, which is exact for those the neighbour shares
+	float stitched = max(
+		max(blockStitch.x * (1.0f - step(0.5f, position.x)), blockStitch.y * step(15.5f, position.x)),
+		max(blockStitch.z * (1.0f - step(0.5f, position.z)), blockStitch.w * step(15.5f, position.z))
+	);
+	float altitude = mix(position.y, (color.z + stitchHigh * 256.0f) * 0.5f, stitched);
+
+	// materials of the four corners of the cell: top left, top right, bottom left, bottom right
+	float cellStep = exp2(lod);
+	vec2 topLeft = vec2(blockX, blockZ) * 16.0f + position.xz - vec2(mod(corner, 2.0f), floor(corner / 2.0f)) * cellStep;
+	vec3 material0 = cellMaterial(topLeft);
+	vec3 material1 = cellMaterial(topLeft + vec2(cellStep, 0.0f));
+	vec3 material2 = cellMaterial(topLeft + vec2(0.0f, cellStep));
+	vec3 material3 = cellMaterial(topLeft + vec2(cellStep, cellStep));
+
+	// position is in cells within the block and altitude units
+	vec3 localPosition = vec3(position.x * CELL_SIZE, altitude * HEIGHT_UNIT, position.z * CELL_SIZE);
+
+	v_texcoord0 = vec4(localPosition.z / 160.0f, localPosition.x / 160.0f, 0.0f, 0.0f);
+	v_weight = vec4_splat(1.0f) - min(abs(vec4_splat(corner) - vec4(0.0f, 1.0f, 2.0f, 3.0f)), vec4_splat(1.0f));
+	v_materialID0 = ivec4(material0.x, material1.x, material2.x, material3.x);
+	v_materialID1 = ivec4(material0.y, material1.y, material2.y, material3.y);
+	v_materialBlend = vec4(material0.z, material1.z, material2.z, material3.z) / 255.0f;
+	v_lightLevel = color.x / 255.0f;
+	v_waterAlpha = color.y / 255.0f;
+
+	// blocks are laid out on the island grid, 16 cells apart
+	vec2 blockPosition = vec2(blockX, blockZ) * 16.0f * CELL_SIZE;
+	vec3 transformedPosition = vec3(localPosition.x + blockPosition.x, localPosition.y, localPosition.z + blockPosition.y);
 
 	vec4 cs_position = mul(u_view, vec4(transformedPosition, 1.0f));
 	v_distToCamera = cs_position.z;
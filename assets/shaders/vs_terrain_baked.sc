@@ -0,0 +1,65 @@
+$input a_position, a_color0
+$output v_texcoord0, v_texcoord1, v_lightLevel, v_waterAlpha
+
+#include <bgfx_shader.sh>
+
+// LandIsland::CellSize and LandIsland::HeightUnit
+#define CELL_SIZE 10.0f
+#define HEIGHT_UNIT 0.67f
+// LandIsland::BakedTileSize and LandIsland::BakedAtlasTiles
+#define BAKED_TILE_SIZE 64.0f
+#define BAKED_ATLAS_TILES 16.0f
+
+// Four blocks per vec4, see vs_terrain
+uniform vec4 u_blockData[64];
+
+// Normalized bytes back to their integer value
+vec4 bytes(vec4 normalized)
+{
+	return floor(normalized * 255.0f + 0.5f);
+}
+
+void main()
+{
+	// x, altitude and z within the block and the index of the block
+	vec4 position = bytes(a_position);
+	// light level, water alpha, low byte of the stitch altitude and the packed corner, see LandVertex
+	vec4 color = bytes(a_color0);
+
+	// pick the component of the block out of the array
+	float blockIndex = position.w;
+	float blockSlot = mod(blockIndex, 4.0f);
+	vec4 blockMask = vec4_splat(1.0f) - min(abs(vec4_splat(blockSlot) - vec4(0.0f, 1.0f, 2.0f, 3.0f)), vec4_splat(1.0f));
+	float blockData = dot(u_blockData[int(blockIndex * 0.25f)], blockMask);
+	float edges = floor(blockData / 1024.0f);
+	float blockZ = floor((blockData - edges * 1024.0f) / 32.0f);
+	float blockX = blockData - edges * 1024.0f - blockZ * 32.0f;
+	vec4 blockStitch = mod(floor(vec4_splat(edges) / vec4(1.0f, 2.0f, 4.0f, 8.0f)), vec4_splat(2.0f));
+
+	// the 9th bit of the stitch altitude is above the weight corner
+	float stitchHigh = mod(floor(color.w / 4.0f), 2.0f);
+
+	// vertices on a stitched edge take the altitude of the coarser edge, which is exact for those the neighbour shares
+	float stitched = max(
+		max(blockStitch.x * (1.0f - step(0.5f, position.x)), blockStitch.y * step(15.5f, position.x)),
+		max(blockStitch.z * (1.0f - step(0.5f, position.z)), blockStitch.w * step(15.5f, position.z))
+	);
+	float altitude = mix(position.y, (color.z + stitchHigh * 256.0f) * 0.5f, stitched);
+
+	// position is in cells within the block and altitude units
+	vec3 localPosition = vec3(position.x * CELL_SIZE, altitude * HEIGHT_UNIT, position.z * CELL_SIZE);
+
+	v_texcoord0 = vec4(localPosition.z / 160.0f, localPosition.x / 160.0f, 0.0f, 0.0f);
+	// the tile of the block in the atlas, kept half a texel inside its edges so the neighbouring tiles do not bleed in
+	vec2 tile = vec2(mod(blockIndex, BAKED_ATLAS_TILES), floor(blockIndex / BAKED_ATLAS_TILES));
+	vec2 tileTexel = clamp(v_texcoord0.xy * BAKED_TILE_SIZE, vec2_splat(0.5f), vec2_splat(BAKED_TILE_SIZE - 0.5f));
+	v_texcoord1 = vec4((tile * BAKED_TILE_SIZE + tileTexel) / (BAKED_TILE_SIZE * BAKED_ATLAS_TILES), 0.0f, 0.0f);
+	v_lightLevel = color.x / 255.0f;
+	v_waterAlpha = color.y / 255.0f;
+
+	// blocks are laid out on the island grid, 16 cells apart
+	vec2 blockPosition = vec2(blockX, blockZ) * 16.0f * CELL_SIZE;
+	vec3 transformedPosition = vec3(localPosition.x + blockPosition.x, localPosition.y, localPosition.z + blockPosition.y);
+
+	gl_Position = mul(u_viewProj, vec4(transformedPosition, 1.0f));
+}
@@ -66,6 +66,9 @@ class ANMFile
 	/// Read file from the input source
 	virtual void ReadFile(std::istream& stream);
 
+	/// Read keyframes from a stream starting at the given offset of the file
+	virtual void ReadKeyframes(std::istream& stream, std::size_t streamOffset);
+
 	/// Write file to the input source
 	virtual void WriteFile(std::ostream& stream) const;
 
@@ -80,6 +83,12 @@ class ANMFile
 	/// Read anm file from a buffer
 	void Open(const std::vector<uint8_t>& buffer);
 
+	/// Read anm file from memory not owned by the caller
+	void Open(const uint8_t* buffer, std::size_t size);
+
+	/// Read anm file split in a header and the keyframe data following it, as stored in anim packs
+	void Open(const uint8_t* header, std::size_t headerSize, const uint8_t* keyframes, std::size_t keyframesSize);
+
 	/// Write anm file to path on the filesystem
 	void Write(const std::string& file);
 
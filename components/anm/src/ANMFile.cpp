@@ -140,25 +140,41 @@ void ANMFile::ReadFile(std::istream& stream)
 	// First 84 bytes
 	stream.read(reinterpret_cast<char*>(&_header), sizeof(ANMHeader));
 
+	ReadKeyframes(stream, 0);
+}
+
+void ANMFile::ReadKeyframes(std::istream& stream, std::size_t streamOffset)
+{
+	assert(!_isLoaded);
+
+	// Offsets in the file are from the start of the header, seek relative to what the stream holds
+	auto seek = [this, &stream, streamOffset](uint32_t offset) {
+		if (offset < streamOffset)
+		{
+			Fail("Keyframe offset points before keyframe data.");
+		}
+		stream.seekg(offset - streamOffset);
+	};
+
 	_keyframes.resize(_header.frame_count);
 	for (uint32_t i = 0; i < _header.frame_count; ++i)
 	{
-		stream.seekg(_header.frames_base + i * sizeof(uint32_t));
+		seek(static_cast<uint32_t>(_header.frames_base + i * sizeof(uint32_t)));
 
 		// In Keyframe offset block
 		uint32_t offset;
 		stream.read(reinterpret_cast<char*>(&offset), sizeof(offset));
 
 		// Keyframe pointer
-		stream.seekg(offset);
+		seek(offset);
 		stream.read(reinterpret_cast<char*>(&offset), sizeof(offset));
 
 		// Bone offset block
-		stream.seekg(offset);
+		seek(offset);
 		stream.read(reinterpret_cast<char*>(&offset), sizeof(offset));
 
 		// Bone block
-		stream.seekg(offset);
+		seek(offset);
 		uint32_t bone_count;
 		stream.read(reinterpret_cast<char*>(&bone_count), sizeof(bone_count));
 
@@ -195,16 +211,38 @@ void ANMFile::Open(const std::string& file)
 }
 
 void ANMFile::Open(const std::vector<uint8_t>& buffer)
+{
+	Open(buffer.data(), buffer.size() * sizeof(buffer[0]));
+}
+
+void ANMFile::Open(const uint8_t* buffer, std::size_t size)
 {
 	assert(!_isLoaded);
 
-	imemstream stream(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(buffer[0]));
+	imemstream stream(reinterpret_cast<const char*>(buffer), size);
 
 	_filename = "buffer";
 
 	ReadFile(stream);
 }
 
+void ANMFile::Open(const uint8_t* header, std::size_t headerSize, const uint8_t* keyframes, std::size_t keyframesSize)
+{
+	assert(!_isLoaded);
+
+	_filename = "buffer";
+
+	if (headerSize < sizeof(ANMHeader))
+	{
+		Fail("Header too small to be a valid ANM header.");
+	}
+
+	std::memcpy(&_header, header, sizeof(ANMHeader));
+
+	imemstream stream(reinterpret_cast<const char*>(keyframes), keyframesSize);
+	ReadKeyframes(stream, headerSize);
+}
+
 void ANMFile::Write(const std::string& file)
 {
 	assert(!_isLoaded);
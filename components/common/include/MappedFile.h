@@ -0,0 +1,134 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace openblack
+{
+
+/// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	~MappedFile()
+	{
+#ifdef _WIN32
+		if (_data != nullptr)
+		{
+			UnmapViewOfFile(_data);
+		}
+		if (_mapping != nullptr)
+		{
+			CloseHandle(_mapping);
+		}
+		if (_file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(_file);
+		}
+#else
+		if (_data != nullptr)
+		{
+			munmap(const_cast<uint8_t*>(_data), _size);
+		}
+#endif
+	}
+
+	/// Map file, an empty file is mapped to an empty span
+	bool Open(const std::string& filename)
+	{
+#ifdef _WIN32
+		_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		                    FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (_file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(_file, &fileSize))
+		{
+			return false;
+		}
+		_size = static_cast<std::size_t>(fileSize.QuadPart);
+		if (_size == 0)
+		{
+			return true;
+		}
+		_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (_mapping == nullptr)
+		{
+			return false;
+		}
+		_data = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+		return _data != nullptr;
+#else
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+		{
+			close(fd);
+			return false;
+		}
+		_size = static_cast<std::size_t>(st.st_size);
+		if (_size == 0)
+		{
+			close(fd);
+			return true;
+		}
+		void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+		// The mapping holds its own reference to the file
+		close(fd);
+		if (data == MAP_FAILED)
+		{
+			return false;
+		}
+		_data = static_cast<const uint8_t*>(data);
+		return true;
+#endif
+	}
+
+	[[nodiscard]] const uint8_t* GetData() const { return _data; }
+	[[nodiscard]] std::size_t GetSize() const { return _size; }
+
+private:
+#ifdef _WIN32
+	HANDLE _file {INVALID_HANDLE_VALUE};
+	HANDLE _mapping {nullptr};
+#endif
+	const uint8_t* _data {nullptr};
+	std::size_t _size {0};
+};
+
+} // namespace openblack
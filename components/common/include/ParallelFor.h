@@ -0,0 +1,70 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace openblack
+{
+
+/// Call function(i) for every i in [0, count) split in contiguous chunks over all hardware threads.
+/// Blocks until every call has returned. The first exception in index order is rethrown on the calling thread.
+template <typename Function>
+void ParallelFor(std::size_t count, Function function)
+{
+	const auto threadCount = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1U), count);
+	if (threadCount <= 1)
+	{
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			function(i);
+		}
+		return;
+	}
+
+	std::vector<std::exception_ptr> errors(threadCount);
+	std::vector<std::thread> workers;
+	workers.reserve(threadCount);
+	const auto chunkSize = (count + threadCount - 1) / threadCount;
+	for (std::size_t t = 0; t < threadCount; ++t)
+	{
+		workers.emplace_back([&function, &errors, t, chunkSize, count]() {
+			const auto end = std::min(count, (t + 1) * chunkSize);
+			try
+			{
+				for (auto i = t * chunkSize; i < end; ++i)
+				{
+					function(i);
+				}
+			}
+			catch (...)
+			{
+				errors[t] = std::current_exception();
+			}
+		});
+	}
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+	for (auto& error : errors)
+	{
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+}
+
+} // namespace openblack
@@ -0,0 +1,61 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace openblack
+{
+
+// TODO(bwrsandman): If you read this in c++20, replace with std::span
+template <typename T>
+class Span
+{
+	const T* _data;
+	std::size_t _size;
+
+public:
+	constexpr Span() noexcept
+	    : _data(nullptr)
+	    , _size(0)
+	{
+	}
+
+	constexpr Span(const T* data, std::size_t size) noexcept
+	    : _data(data)
+	    , _size(size)
+	{
+	}
+
+	Span(const std::vector<T>& original) noexcept
+	    : _data(original.data())
+	    , _size(original.size())
+	{
+	}
+
+	[[nodiscard]] constexpr const T* data() const noexcept { return _data; }
+	[[nodiscard]] constexpr std::size_t size() const noexcept { return _size; }
+	[[nodiscard]] constexpr bool empty() const noexcept { return _size == 0; }
+	constexpr const T& operator[](std::size_t index) const noexcept { return _data[index]; }
+
+	// First element.
+	[[nodiscard]] constexpr const T* begin() const noexcept { return _data; }
+
+	// One past the last element.
+	[[nodiscard]] constexpr const T* end() const noexcept { return _data + _size; }
+
+	[[nodiscard]] constexpr Span subspan(std::size_t offset, std::size_t count) const noexcept
+	{
+		return Span(_data + offset, count);
+	}
+};
+
+} // namespace openblack
@@ -252,6 +252,9 @@ class L3DFile
 	/// Read l3d file from a buffer
 	void Open(const std::vector<uint8_t>& buffer);
 
+	/// Read l3d file from memory not owned by the caller, such as a pack file mapping
+	void Open(const uint8_t* buffer, std::size_t size);
+
 	/// Write l3d file to path on the filesystem
 	void Write(const std::string& file);
 
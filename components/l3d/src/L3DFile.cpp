@@ -632,10 +632,15 @@ void L3DFile::Open(const std::string& file)
 }
 
 void L3DFile::Open(const std::vector<uint8_t>& buffer)
+{
+	Open(buffer.data(), buffer.size() * sizeof(buffer[0]));
+}
+
+void L3DFile::Open(const uint8_t* buffer, std::size_t size)
 {
 	assert(!_isLoaded);
 
-	imemstream stream(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(buffer[0]));
+	imemstream stream(reinterpret_cast<const char*>(buffer), size);
 
 	_filename = "buffer";
 
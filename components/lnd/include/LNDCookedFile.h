@@ -0,0 +1,113 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#pragma once
+
+#include "LNDFileView.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace openblack::lnd
+{
+
+/// Sections of a cooked LND, each one ready to be handed to the GPU or copied as is
+enum class LNDCookedSection : uint32_t
+{
+	Vertices,          ///< LNDTerrainVertex, TerrainBlockVertexCount per block in the order of the LND
+	Indices,           ///< uint16_t, TerrainBlockIndexCount for the full level of detail of one block
+	CountryLookup,     ///< RGBA8, see BuildTerrainCountryLookup
+	Materials,         ///< RGB5A1 texels of every material one layer after the other, without their type
+	FilteredMaterials, ///< float, see FilterTerrainMaterial, one material after the other
+	BakedTiles,        ///< RGBA8, see BakeTerrainBlock, one block after the other
+
+	Count
+};
+
+struct LNDCookedSectionEntry
+{
+	uint64_t offset;
+	uint64_t size;
+};
+static_assert(sizeof(LNDCookedSectionEntry) == 16);
+
+struct LNDCookedHeader
+{
+	char magic[4];       ///< "LNDC"
+	uint32_t version;    ///< LNDCookedFile::Version it was written with
+	uint64_t sourceHash; ///< LNDFileView::ComputeHash of the LND it was cooked from
+	uint32_t blockCount;
+	uint32_t materialCount;
+	LNDCookedSectionEntry sections[static_cast<std::size_t>(LNDCookedSection::Count)];
+};
+static_assert(sizeof(LNDCookedHeader) == 24 + 16 * static_cast<std::size_t>(LNDCookedSection::Count));
+
+/**
+  Terrain data of an LND built ahead of time by lndtool cook, so loading an
+  island only has to map it.
+
+  The sections point into the mapped file and stay valid for the lifetime of
+  the file. A cooked file only stands for the LND whose hash it recorded.
+ */
+class LNDCookedFile
+{
+public:
+	/// Bumped whenever the layout of the file or the data in the sections changes
+	static constexpr uint32_t Version = 1;
+	/// Sections start on this alignment so they can be read in place
+	static constexpr uint32_t SectionAlignment = 16;
+
+protected:
+	/// True when a file has been loaded
+	bool _isLoaded;
+
+	std::string _filename;
+
+	std::unique_ptr<MappedFile> _mappedFile;
+
+	LNDCookedHeader _header;
+
+	/// Error handling
+	void Fail(const std::string& msg);
+
+	/// Check the header and the bounds of the sections
+	void ReadFile(const uint8_t* data, std::size_t size);
+
+public:
+	LNDCookedFile();
+	LNDCookedFile(const LNDCookedFile&) = delete;
+	LNDCookedFile& operator=(const LNDCookedFile&) = delete;
+
+	virtual ~LNDCookedFile();
+
+	/// Map cooked file from the filesystem
+	void Open(const std::string& file);
+
+	/// Build the terrain data of source and write it to file
+	void Cook(const LNDFileView& source, const std::string& file);
+
+	[[nodiscard]] const std::string& GetFilename() const { return _filename; }
+	[[nodiscard]] const LNDCookedHeader& GetHeader() const { return _header; }
+	/// Whether the file was cooked from an LND with this hash, see LNDFileView::ComputeHash
+	[[nodiscard]] bool Matches(uint64_t sourceHash) const { return _header.sourceHash == sourceHash; }
+
+	template <typename T>
+	[[nodiscard]] Span<T> GetSection(LNDCookedSection section) const
+	{
+		const auto& entry = _header.sections[static_cast<std::size_t>(section)];
+		return Span<T>(reinterpret_cast<const T*>(GetData() + entry.offset), entry.size / sizeof(T));
+	}
+
+private:
+	[[nodiscard]] const uint8_t* GetData() const;
+};
+
+} // namespace openblack::lnd
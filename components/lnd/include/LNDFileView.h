@@ -0,0 +1,99 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#pragma once
+
+#include "LNDFile.h"
+
+#include <Span.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace openblack
+{
+class MappedFile;
+}
+
+namespace openblack::lnd
+{
+
+struct LNDLowResolutionTextureView
+{
+	LNDLowResolutionTextureHeader header;
+	Span<uint8_t> texels;
+};
+
+/**
+  Read-only view of an LND mapped into memory.
+
+  Unlike LNDFile, nothing is copied out of the file: blocks, countries,
+  materials and extra textures are spans into the mapping which stay valid for
+  the lifetime of the view.
+ */
+class LNDFileView
+{
+protected:
+	/// True when a file has been loaded
+	bool _isLoaded;
+
+	std::string _filename;
+
+	std::unique_ptr<MappedFile> _mappedFile;
+	/// Sections which do not sit on their natural alignment in the file are
+	/// copied here instead of being read in place
+	std::vector<std::vector<uint32_t>> _realignedSections;
+
+	LNDHeader _header;
+	std::vector<LNDLowResolutionTextureView> _lowResolutionTextures;
+	Span<LNDBlock> _blocks;
+	Span<LNDCountry> _countries;
+	Span<LNDMaterial> _materials;
+	const LNDExtraTextures* _extra;
+	Span<uint8_t> _unaccounted;
+
+	/// Error handling
+	void Fail(const std::string& msg);
+
+	/// Point the spans into the mapped file
+	void ReadFile(const uint8_t* data, std::size_t size);
+
+	template <typename T>
+	Span<T> MapSection(const uint8_t* data, std::size_t size, std::size_t& offset, std::size_t count, const char* name);
+
+public:
+	LNDFileView();
+	LNDFileView(const LNDFileView&) = delete;
+	LNDFileView& operator=(const LNDFileView&) = delete;
+
+	virtual ~LNDFileView();
+
+	/// Map lnd file from the filesystem
+	void Open(const std::string& file);
+
+	[[nodiscard]] const std::string& GetFilename() const { return _filename; }
+	[[nodiscard]] const LNDHeader& GetHeader() const { return _header; }
+	[[nodiscard]] const std::vector<LNDLowResolutionTextureView>& GetLowResolutionTextures() const
+	{
+		return _lowResolutionTextures;
+	}
+	[[nodiscard]] Span<LNDBlock> GetBlocks() const { return _blocks; }
+	[[nodiscard]] Span<LNDCountry> GetCountries() const { return _countries; }
+	[[nodiscard]] Span<LNDMaterial> GetMaterials() const { return _materials; }
+	[[nodiscard]] const LNDExtraTextures& GetExtra() const { return *_extra; }
+	[[nodiscard]] Span<uint8_t> GetUnaccounted() const { return _unaccounted; }
+
+	/// 64 bit FNV-1a of the whole file, cooked files keep the hash of their source to tell when it changed
+	[[nodiscard]] uint64_t ComputeHash() const;
+};
+
+} // namespace openblack::lnd
@@ -0,0 +1,101 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#pragma once
+
+#include "LNDFileView.h"
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Terrain data derived from the blocks, countries and materials of an LND.
+ *
+ * The game builds all of it when an island is loaded and lndtool cook writes
+ * the same data ahead of time, both go through the functions below so a
+ * cooked file is always interchangeable with what the game would build.
+ */
+
+namespace openblack::lnd
+{
+
+/// Cells per side of the island grid: 32 blocks of 16 cells plus a row of padding so the far corners of the last blocks
+/// can be read without bounds checks
+constexpr uint16_t TerrainGridSize = 32 * 16 + 1;
+/// Quads of 4 verts for 16x16, 8x8, 4x4 and 2x2 cells, stored one level of detail after the other
+constexpr uint32_t TerrainBlockVertexCount = (16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4;
+/// 16*16 quads of 2 tris, the same for every block. Coarser levels use the beginning.
+constexpr uint32_t TerrainBlockIndexCount = 16 * 16 * 2 * 3;
+/// Texels per side of the baked materials of a block, 4 per cell
+constexpr uint16_t TerrainBakedTileSize = 64;
+/// Columns of the country lookup, one per altitude plus noise
+constexpr uint16_t TerrainLookupAltitudes = sizeof(LNDCountry::materials) / sizeof(LNDCountry::materials[0]);
+/// Rows of the country lookup, as many as the 4 bits of the cell properties can address
+constexpr uint16_t TerrainLookupCountries = 16;
+
+/// Index of a cell in the grid arrays, x major like the cells of a block
+[[nodiscard]] constexpr uint32_t TerrainGridIndex(uint16_t x, uint16_t y)
+{
+	return x * TerrainGridSize + y;
+}
+
+/// Corner of a cell. The terrain shader looks up the materials of all four corners of the cell from the island grid, the
+/// corner only selects which one the vertex is weighted towards, so the two triangles of a cell can share their vertices.
+struct LNDTerrainVertex
+{
+	uint8_t position[4]; ///< cell x, altitude, cell z within the block and index of the block
+	uint8_t lightLevel;
+	uint8_t waterAlpha;
+	/// Low byte of the stitch altitude, the sum of the altitudes of the two vertices of the next coarser level of detail
+	/// on either side of this one along the block edge. Used to stitch against a coarser neighbour.
+	uint8_t stitchAltitude;
+	/// Corner used as weight in the lowest 2 bits, then the 9th bit of the stitch altitude and the level of detail of
+	/// the cell the vertex belongs to
+	uint8_t cornerLod;
+
+	LNDTerrainVertex() = default;
+	LNDTerrainVertex(uint8_t x, uint8_t altitude, uint8_t z, uint8_t blockIndex, uint8_t corner, uint8_t lod,
+	                 uint8_t _lightLevel, uint8_t _waterAlpha, uint16_t _stitchAltitude);
+};
+static_assert(sizeof(LNDTerrainVertex) == 8);
+
+/// TerrainGridSize * TerrainGridSize arrays of every cell of the island
+struct LNDTerrainGrid
+{
+	const uint8_t* altitudes;
+	const LNDCell::Properties* properties;
+	const uint8_t* luminosities;
+};
+
+/// Copy the cells of every block into the grid arrays, cells without a block are deep water. The 32x32 look up table
+/// holds the index of the block at each position plus one, or 0 for none.
+void BuildTerrainGrid(Span<LNDBlock> blocks, const uint8_t* lookUpTable, uint8_t* altitudes,
+                      LNDCell::Properties* properties, uint8_t* luminosities);
+
+/// Fill the 6 indices of each of cellCount quads, the first quad starting at firstVertex
+void BuildTerrainIndices(uint16_t* indices, uint32_t cellCount = 16 * 16, uint16_t firstVertex = 0);
+
+/// Fill TerrainBlockVertexCount vertices of the block at blockX, blockZ for every level of detail
+void BuildTerrainVertices(const LNDTerrainGrid& grid, uint32_t blockX, uint32_t blockZ, uint8_t blockIndex,
+                          LNDTerrainVertex* vertices);
+
+/// Both material ids and the blend coefficient for every country (row) and altitude plus noise (column), RGBA8
+void BuildTerrainCountryLookup(Span<LNDCountry> countries, uint8_t* texels);
+
+/// Box filter the colour of a material down to TerrainBakedTileSize texels per side, 3 floats per texel
+void FilterTerrainMaterial(const LNDMaterial& material, float* texels);
+
+/// Blend the filtered materials of every cell corner of a block into TerrainBakedTileSize texels per side, RGBA8 with x
+/// along the rows. The corners are weighted over the triangles of the full level of detail mesh, as the terrain shader
+/// does for each pixel.
+void BakeTerrainBlock(const LNDTerrainGrid& grid, Span<LNDCountry> countries, const uint8_t* noise,
+                      const float* filteredMaterials, std::size_t materialCount, uint32_t blockX, uint32_t blockZ,
+                      uint8_t* texels);
+
+} // namespace openblack::lnd
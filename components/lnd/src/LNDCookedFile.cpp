@@ -0,0 +1,227 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+/*
+ * The layout of a cooked LND File is as follows:
+ *
+ * - LNDCookedHeader, with the hash of the source LND and the offset and size
+ *         of every section
+ * ------------------------ start of sections, each one aligned to 16 bytes
+ * - Vertices of every block
+ * - Indices of one block
+ * - Country lookup
+ * - Material texels
+ * - Filtered materials
+ * - Baked tiles of every block
+ */
+
+#include <LNDCookedFile.h>
+
+#include <MappedFile.h>
+
+#include <LNDTerrain.h>
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace openblack::lnd;
+
+namespace
+{
+constexpr char Magic[4] = {'L', 'N', 'D', 'C'};
+}
+
+LNDCookedFile::LNDCookedFile()
+    : _isLoaded(false)
+    , _header {}
+{
+}
+
+LNDCookedFile::~LNDCookedFile() = default;
+
+/// Error handling
+void LNDCookedFile::Fail(const std::string& msg)
+{
+	throw std::runtime_error("LND Error: " + msg + "\nFilename: " + _filename);
+}
+
+void LNDCookedFile::ReadFile(const uint8_t* data, std::size_t size)
+{
+	assert(!_isLoaded);
+
+	if (size < sizeof(LNDCookedHeader))
+	{
+		Fail("File too small to be a valid cooked LND file.");
+	}
+
+	std::memcpy(&_header, data, sizeof(LNDCookedHeader));
+
+	if (std::memcmp(_header.magic, Magic, sizeof(Magic)) != 0)
+	{
+		Fail("File is not a cooked LND file.");
+	}
+	if (_header.version != Version)
+	{
+		Fail("File has version " + std::to_string(_header.version) + " expected " + std::to_string(Version));
+	}
+
+	// the sizes follow from the counts, anything else was not written by Cook
+	const std::size_t tileTexels = TerrainBakedTileSize * TerrainBakedTileSize;
+	const std::size_t expectedSizes[] = {
+	    _header.blockCount * TerrainBlockVertexCount * sizeof(LNDTerrainVertex),
+	    TerrainBlockIndexCount * sizeof(uint16_t),
+	    TerrainLookupAltitudes * TerrainLookupCountries * 4,
+	    _header.materialCount * sizeof(LNDMaterial::texels),
+	    _header.materialCount * tileTexels * 3 * sizeof(float),
+	    _header.blockCount * tileTexels * 4,
+	};
+	static_assert(sizeof(expectedSizes) / sizeof(expectedSizes[0]) == static_cast<std::size_t>(LNDCookedSection::Count));
+
+	for (std::size_t i = 0; i < static_cast<std::size_t>(LNDCookedSection::Count); i++)
+	{
+		const auto& entry = _header.sections[i];
+		if (entry.size != expectedSizes[i])
+		{
+			Fail("Section " + std::to_string(i) + " has size " + std::to_string(entry.size) + " expected " +
+			     std::to_string(expectedSizes[i]));
+		}
+		if (entry.offset % SectionAlignment != 0 || entry.offset > size || entry.size > size - entry.offset)
+		{
+			Fail("Section " + std::to_string(i) + " is misaligned or beyond the end of the file");
+		}
+	}
+
+	_isLoaded = true;
+}
+
+void LNDCookedFile::Open(const std::string& file)
+{
+	assert(!_isLoaded);
+
+	_filename = file;
+
+	_mappedFile = std::make_unique<MappedFile>();
+	if (!_mappedFile->Open(_filename))
+	{
+		Fail("Could not map file.");
+	}
+
+	ReadFile(_mappedFile->GetData(), _mappedFile->GetSize());
+}
+
+void LNDCookedFile::Cook(const LNDFileView& source, const std::string& file)
+{
+	assert(!_isLoaded);
+
+	_filename = file;
+
+	const auto blocks = source.GetBlocks();
+	const auto countries = source.GetCountries();
+	const auto materials = source.GetMaterials();
+	if (blocks.size() > 0xFF)
+	{
+		Fail("Source has " + std::to_string(blocks.size()) + " blocks, more than the lookup table can address");
+	}
+
+	std::vector<uint8_t> altitudes(TerrainGridSize * TerrainGridSize);
+	std::vector<LNDCell::Properties> properties(TerrainGridSize * TerrainGridSize);
+	std::vector<uint8_t> luminosities(TerrainGridSize * TerrainGridSize);
+	BuildTerrainGrid(blocks, source.GetHeader().lookUpTable, altitudes.data(), properties.data(), luminosities.data());
+	const LNDTerrainGrid grid {altitudes.data(), properties.data(), luminosities.data()};
+
+	std::vector<LNDTerrainVertex> vertices(blocks.size() * TerrainBlockVertexCount);
+	for (std::size_t i = 0; i < blocks.size(); i++)
+	{
+		BuildTerrainVertices(grid, blocks[i].blockX, blocks[i].blockZ, static_cast<uint8_t>(i),
+		                     &vertices[i * TerrainBlockVertexCount]);
+	}
+
+	std::vector<uint16_t> indices(TerrainBlockIndexCount);
+	BuildTerrainIndices(indices.data());
+
+	std::vector<uint8_t> countryLookup(TerrainLookupAltitudes * TerrainLookupCountries * 4);
+	BuildTerrainCountryLookup(countries, countryLookup.data());
+
+	constexpr std::size_t tileTexels = TerrainBakedTileSize * TerrainBakedTileSize;
+	std::vector<float> filteredMaterials(materials.size() * tileTexels * 3);
+	for (std::size_t i = 0; i < materials.size(); i++)
+	{
+		FilterTerrainMaterial(materials[i], &filteredMaterials[i * tileTexels * 3]);
+	}
+
+	std::vector<uint8_t> bakedTiles(blocks.size() * tileTexels * 4);
+	for (std::size_t i = 0; i < blocks.size(); i++)
+	{
+		BakeTerrainBlock(grid, countries, source.GetExtra().noise.texels, filteredMaterials.data(), materials.size(),
+		                 blocks[i].blockX, blocks[i].blockZ, &bakedTiles[i * tileTexels * 4]);
+	}
+
+	std::ofstream stream(_filename, std::ios::binary);
+	if (!stream.is_open())
+	{
+		Fail("Could not open file.");
+	}
+
+	// Prepare header
+	std::memcpy(_header.magic, Magic, sizeof(Magic));
+	_header.version = Version;
+	_header.sourceHash = source.ComputeHash();
+	_header.blockCount = static_cast<uint32_t>(blocks.size());
+	_header.materialCount = static_cast<uint32_t>(materials.size());
+
+	uint64_t offset = sizeof(LNDCookedHeader);
+	auto place = [this, &offset](LNDCookedSection section, std::size_t size) {
+		offset = (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+		_header.sections[static_cast<std::size_t>(section)] = {offset, size};
+		offset += size;
+	};
+	place(LNDCookedSection::Vertices, vertices.size() * sizeof(vertices[0]));
+	place(LNDCookedSection::Indices, indices.size() * sizeof(indices[0]));
+	place(LNDCookedSection::CountryLookup, countryLookup.size());
+	place(LNDCookedSection::Materials, materials.size() * sizeof(LNDMaterial::texels));
+	place(LNDCookedSection::FilteredMaterials, filteredMaterials.size() * sizeof(filteredMaterials[0]));
+	place(LNDCookedSection::BakedTiles, bakedTiles.size());
+
+	stream.write(reinterpret_cast<const char*>(&_header), sizeof(LNDCookedHeader));
+	// sections are written in the order they were placed, padded up to their offset
+	auto write = [this, &stream](LNDCookedSection section, const void* data) {
+		const auto& entry = _header.sections[static_cast<std::size_t>(section)];
+		const char padding[SectionAlignment] = {};
+		stream.write(padding, static_cast<std::streamsize>(entry.offset - static_cast<uint64_t>(stream.tellp())));
+		if (data != nullptr)
+		{
+			stream.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(entry.size));
+		}
+	};
+	write(LNDCookedSection::Vertices, vertices.data());
+	write(LNDCookedSection::Indices, indices.data());
+	write(LNDCookedSection::CountryLookup, countryLookup.data());
+	// the type in front of every material is left out so the texels form one array
+	write(LNDCookedSection::Materials, nullptr);
+	for (const auto& material : materials)
+	{
+		stream.write(reinterpret_cast<const char*>(material.texels), sizeof(material.texels));
+	}
+	write(LNDCookedSection::FilteredMaterials, filteredMaterials.data());
+	write(LNDCookedSection::BakedTiles, bakedTiles.data());
+
+	if (!stream)
+	{
+		Fail("Could not write file.");
+	}
+}
+
+const uint8_t* LNDCookedFile::GetData() const
+{
+	assert(_isLoaded);
+	return _mappedFile->GetData();
+}
@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+/*
+ * See LNDFile.cpp for the layout of a LND File.
+ */
+
+#include <LNDFileView.h>
+
+#include <MappedFile.h>
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+using namespace openblack::lnd;
+using openblack::Span;
+
+LNDFileView::LNDFileView()
+    : _isLoaded(false)
+    , _header {}
+    , _extra(nullptr)
+{
+}
+
+LNDFileView::~LNDFileView() = default;
+
+/// Error handling
+void LNDFileView::Fail(const std::string& msg)
+{
+	throw std::runtime_error("LND Error: " + msg + "\nFilename: " + _filename);
+}
+
+template <typename T>
+Span<T> LNDFileView::MapSection(const uint8_t* data, std::size_t size, std::size_t& offset, std::size_t count,
+                                const char* name)
+{
+	static_assert(alignof(T) <= alignof(uint32_t));
+
+	if (count > (size - offset) / sizeof(T))
+	{
+		Fail(std::string(name) + " are beyond the end of the file");
+	}
+
+	const auto* section = data + offset;
+	offset += count * sizeof(T);
+
+	if (reinterpret_cast<std::uintptr_t>(section) % alignof(T) == 0)
+	{
+		return Span<T>(reinterpret_cast<const T*>(section), count);
+	}
+
+	// Only reachable when the low resolution textures leave the file misaligned
+	auto& copy = _realignedSections.emplace_back((count * sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+	std::memcpy(copy.data(), section, count * sizeof(T));
+	return Span<T>(reinterpret_cast<const T*>(copy.data()), count);
+}
+
+void LNDFileView::ReadFile(const uint8_t* data, std::size_t size)
+{
+	assert(!_isLoaded);
+
+	if (size < sizeof(LNDHeader))
+	{
+		Fail("File too small to be a valid LND file.");
+	}
+
+	// First 1052 bytes
+	std::memcpy(&_header, data, sizeof(LNDHeader));
+	std::size_t offset = sizeof(LNDHeader);
+
+	if (_header.blockSize != sizeof(LNDBlock))
+	{
+		Fail("File has non standard block size got " + std::to_string(_header.blockSize) + " expected " +
+		     std::to_string(sizeof(LNDBlock)));
+	}
+	if (_header.materialSize != sizeof(LNDMaterial))
+	{
+		Fail("File has non standard material size got " + std::to_string(_header.materialSize) + " expected " +
+		     std::to_string(sizeof(LNDMaterial)));
+	}
+	if (_header.countrySize != sizeof(LNDCountry))
+	{
+		Fail("File has non standard country size got " + std::to_string(_header.countrySize) + " expected " +
+		     std::to_string(sizeof(LNDCountry)));
+	}
+	if (_header.blockCount == 0)
+	{
+		Fail("File has no block count");
+	}
+
+	// Low resolution textures are variable sized, only their headers are copied
+	_lowResolutionTextures.resize(_header.lowResolutionCount);
+	for (auto& texture : _lowResolutionTextures)
+	{
+		if (size - offset < sizeof(texture.header))
+		{
+			Fail("Low resolution textures are beyond the end of the file");
+		}
+		std::memcpy(&texture.header, data + offset, sizeof(texture.header));
+		offset += sizeof(texture.header);
+		if (texture.header.size < sizeof(texture.header.size) ||
+		    texture.header.size - sizeof(texture.header.size) > size - offset)
+		{
+			Fail("Low resolution textures are beyond the end of the file");
+		}
+		texture.texels = Span<uint8_t>(data + offset, texture.header.size - sizeof(texture.header.size));
+		offset += texture.texels.size();
+	}
+
+	// take away a block from the count, because it's not in the file?
+	_blocks = MapSection<LNDBlock>(data, size, offset, _header.blockCount - 1, "Blocks");
+	_countries = MapSection<LNDCountry>(data, size, offset, _header.countryCount, "Countries");
+	_materials = MapSection<LNDMaterial>(data, size, offset, _header.materialCount, "Materials");
+	_extra = MapSection<LNDExtraTextures>(data, size, offset, 1, "Extra Textures").data();
+	_unaccounted = Span<uint8_t>(data + offset, size - offset);
+
+	_isLoaded = true;
+}
+
+void LNDFileView::Open(const std::string& file)
+{
+	assert(!_isLoaded);
+
+	_filename = file;
+
+	_mappedFile = std::make_unique<MappedFile>();
+	if (!_mappedFile->Open(_filename))
+	{
+		Fail("Could not map file.");
+	}
+
+	ReadFile(_mappedFile->GetData(), _mappedFile->GetSize());
+}
+
+uint64_t LNDFileView::ComputeHash() const
+{
+	assert(_isLoaded);
+
+	uint64_t hash = 0xcbf29ce484222325;
+	const auto* data = _mappedFile->GetData();
+	for (std::size_t i = 0; i < _mappedFile->GetSize(); i++)
+	{
+		hash = (hash ^ data[i]) * 0x100000001b3;
+	}
+	return hash;
+}
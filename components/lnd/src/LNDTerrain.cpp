@@ -0,0 +1,324 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#include <LNDTerrain.h>
+
+#include <algorithm>
+#include <cassert>
+
+using namespace openblack::lnd;
+
+LNDTerrainVertex::LNDTerrainVertex(uint8_t x, uint8_t altitude, uint8_t z, uint8_t blockIndex, uint8_t corner, uint8_t lod,
+                                   uint8_t _lightLevel, uint8_t _waterAlpha, uint16_t _stitchAltitude)
+    : position {x, altitude, z, blockIndex}
+    , lightLevel(_lightLevel)
+    , waterAlpha(_waterAlpha)
+    , stitchAltitude(static_cast<uint8_t>(_stitchAltitude & 0xFFU))
+    , cornerLod(static_cast<uint8_t>(corner | ((_stitchAltitude >> 8U) << 2U) | (lod << 3U)))
+{
+	assert(corner < 4 && lod < 4 && _stitchAltitude < 0x200);
+}
+
+void openblack::lnd::BuildTerrainGrid(Span<LNDBlock> blocks, const uint8_t* lookUpTable, uint8_t* altitudes,
+                                      LNDCell::Properties* properties, uint8_t* luminosities)
+{
+	LNDCell::Properties emptyProperties {};
+	emptyProperties.fullWater = true;
+
+	std::fill(altitudes, altitudes + TerrainGridSize * TerrainGridSize, 0);
+	std::fill(properties, properties + TerrainGridSize * TerrainGridSize, emptyProperties);
+	std::fill(luminosities, luminosities + TerrainGridSize * TerrainGridSize, 0);
+
+	// the 17th row and column of each block duplicate its neighbours and are skipped
+	for (uint16_t blockX = 0; blockX < 32; blockX++)
+	{
+		for (uint16_t blockZ = 0; blockZ < 32; blockZ++)
+		{
+			const uint8_t blockIndex = lookUpTable[blockX * 32 + blockZ];
+			if (blockIndex == 0)
+			{
+				continue;
+			}
+			assert(blocks.size() >= blockIndex);
+			const auto* cells = blocks[blockIndex - 1].cells;
+			for (uint16_t x = 0; x < 16; x++)
+			{
+				auto index = TerrainGridIndex(blockX * 16 + x, blockZ * 16);
+				for (uint16_t z = 0; z < 16; z++, index++)
+				{
+					const auto& cell = cells[x * 17 + z];
+					altitudes[index] = cell.altitude;
+					properties[index] = cell.properties;
+					luminosities[index] = cell.luminosity;
+				}
+			}
+		}
+	}
+}
+
+void openblack::lnd::BuildTerrainIndices(uint16_t* indices, uint32_t cellCount, uint16_t firstVertex)
+{
+	// BuildTerrainVertices orders the corners of each cell so that the diagonal always runs from the first to the third
+	uint32_t i = 0;
+	for (uint32_t cell = 0; cell < cellCount; cell++)
+	{
+		const auto base = static_cast<uint16_t>(firstVertex + cell * 4);
+		indices[i++] = base + 1;
+		indices[i++] = base + 2;
+		indices[i++] = base + 0;
+
+		indices[i++] = base + 2;
+		indices[i++] = base + 3;
+		indices[i++] = base + 0;
+	}
+	assert(i == cellCount * 6);
+}
+
+void openblack::lnd::BuildTerrainVertices(const LNDTerrainGrid& grid, uint32_t blockX, uint32_t blockZ,
+                                          uint8_t blockIndex, LNDTerrainVertex* vertices)
+{
+	// we'll loop through each cell, 16x16
+	// (the array is 17x17 but the 17th block is questionable data)
+
+	const auto bx = static_cast<uint16_t>(blockX * 16);
+	const auto bz = static_cast<uint16_t>(blockZ * 16);
+
+	// every corner is shared by up to 4 cells, look each one up once
+	struct Corner
+	{
+		uint8_t altitude;
+		LNDCell::Properties properties;
+		uint8_t luminosity;
+	};
+	Corner cells[17][17];
+	for (uint16_t x = 0; x < 17; x++)
+	{
+		// the grid is padded so the far corners of the last block are still in range
+		auto index = TerrainGridIndex(bx + x, bz);
+		for (uint16_t z = 0; z < 17; z++, index++)
+		{
+			cells[x][z] = {grid.altitudes[index], grid.properties[index], grid.luminosities[index]};
+		}
+	}
+
+	// TODO: this is temporary way for drawing landscape, should be moved to the renderer
+	auto getAlpha = [](LNDCell::Properties properties) -> uint8_t {
+		if (properties.hasWater || properties.fullWater)
+			return 0x00;
+		if (properties.coastLine)
+			return 0x80;
+		return 0xFF;
+	};
+
+	uint32_t i = 0;
+	for (uint8_t lod = 0; lod < 4; lod++)
+	{
+		const int step = 1 << lod;
+
+		// sum of the altitudes of the next coarser level around a vertex on the block edge, see LNDTerrainVertex
+		auto stitchAltitude = [&cells, step](int x, int z) -> uint16_t {
+			if ((x == 0 || x == 16) && (z / step) % 2 == 1)
+				return static_cast<uint16_t>(cells[x][z - step].altitude + cells[x][z + step].altitude);
+			if ((z == 0 || z == 16) && (x / step) % 2 == 1)
+				return static_cast<uint16_t>(cells[x - step][z].altitude + cells[x + step][z].altitude);
+			return static_cast<uint16_t>(cells[x][z].altitude * 2);
+		};
+
+		for (int x = 0; x < 16; x += step)
+		{
+			for (int z = 0; z < 16; z += step)
+			{
+				// top left, top right, bottom left, bottom right
+				const int corners[4][2] = {{x, z}, {x + step, z}, {x, z + step}, {x + step, z + step}};
+
+				auto make_vert = [&](uint8_t corner) -> LNDTerrainVertex {
+					const int cornerX = corners[corner][0];
+					const int cornerZ = corners[corner][1];
+					const auto& cell = cells[cornerX][cornerZ];
+					return LNDTerrainVertex(static_cast<uint8_t>(cornerX), cell.altitude, static_cast<uint8_t>(cornerZ),
+					                        blockIndex, corner, lod, cell.luminosity, getAlpha(cell.properties),
+					                        stitchAltitude(cornerX, cornerZ));
+				};
+
+				// cell splitting, see BuildTerrainIndices
+				// winding order = clockwise
+				if (!cells[x][z].properties.split)
+				{
+					// TR/BR/TL  # #    BR/BL/TL  #
+					//             #              # #
+					vertices[i++] = make_vert(0); // TL
+					vertices[i++] = make_vert(1); // TR
+					vertices[i++] = make_vert(3); // BR
+					vertices[i++] = make_vert(2); // BL
+				}
+				else
+				{
+					// BL/TL/TR  # #    TR/BR/BL    #
+					//           #                # #
+					vertices[i++] = make_vert(2); // BL
+					vertices[i++] = make_vert(0); // TL
+					vertices[i++] = make_vert(1); // TR
+					vertices[i++] = make_vert(3); // BR
+				}
+			}
+		}
+	}
+	assert(i == TerrainBlockVertexCount);
+}
+
+void openblack::lnd::BuildTerrainCountryLookup(Span<LNDCountry> countries, uint8_t* texels)
+{
+	std::fill(texels, texels + TerrainLookupAltitudes * TerrainLookupCountries * 4, 0);
+	for (std::size_t country = 0; country < std::min<std::size_t>(countries.size(), TerrainLookupCountries); country++)
+	{
+		for (std::size_t altitude = 0; altitude < TerrainLookupAltitudes; altitude++)
+		{
+			const auto& material = countries[country].materials[altitude];
+			auto* texel = &texels[(country * TerrainLookupAltitudes + altitude) * 4];
+			texel[0] = static_cast<uint8_t>(material.indices[0]);
+			texel[1] = static_cast<uint8_t>(material.indices[1]);
+			texel[2] = static_cast<uint8_t>(material.coefficient);
+		}
+	}
+}
+
+void openblack::lnd::FilterTerrainMaterial(const LNDMaterial& material, float* texels)
+{
+	constexpr uint16_t footprint = LNDMaterial::width / TerrainBakedTileSize;
+	constexpr float scale = 1.0f / (31.0f * footprint * footprint);
+	for (uint16_t row = 0; row < TerrainBakedTileSize; row++)
+	{
+		for (uint16_t column = 0; column < TerrainBakedTileSize; column++)
+		{
+			uint32_t red = 0;
+			uint32_t green = 0;
+			uint32_t blue = 0;
+			for (uint16_t y = 0; y < footprint; y++)
+			{
+				const auto* line = &material.texels[(row * footprint + y) * LNDMaterial::width + column * footprint];
+				for (uint16_t x = 0; x < footprint; x++)
+				{
+					red += line[x].R;
+					green += line[x].G;
+					blue += line[x].B;
+				}
+			}
+			auto* texel = &texels[(row * TerrainBakedTileSize + column) * 3];
+			texel[0] = static_cast<float>(red) * scale;
+			texel[1] = static_cast<float>(green) * scale;
+			texel[2] = static_cast<float>(blue) * scale;
+		}
+	}
+}
+
+void openblack::lnd::BakeTerrainBlock(const LNDTerrainGrid& grid, Span<LNDCountry> countries, const uint8_t* noise,
+                                      const float* filteredMaterials, std::size_t materialCount, uint32_t blockX,
+                                      uint32_t blockZ, uint8_t* texels)
+{
+	constexpr uint16_t texelsPerCell = TerrainBakedTileSize / 16;
+	constexpr std::size_t tileTexels = TerrainBakedTileSize * TerrainBakedTileSize;
+	if (materialCount == 0)
+	{
+		for (std::size_t i = 0; i < tileTexels; i++)
+		{
+			texels[i * 4 + 0] = 0;
+			texels[i * 4 + 1] = 0;
+			texels[i * 4 + 2] = 0;
+			texels[i * 4 + 3] = 0xFF;
+		}
+		return;
+	}
+
+	// add the colour of a cell corner at a texel of the tile, picked like the country lookup of the terrain shader
+	// which leaves countries without an entry on the first material, the GPU clamps the layers of the material array
+	auto addCorner = [&](uint16_t x, uint16_t z, std::size_t texel, float weight, float* colour) {
+		if (weight <= 0.0f)
+			return;
+		const auto index = TerrainGridIndex(x, z);
+		const auto country = grid.properties[index].country;
+		std::size_t first = 0;
+		std::size_t second = 0;
+		float blend = 0.0f;
+		if (country < std::min<std::size_t>(countries.size(), TerrainLookupCountries))
+		{
+			const auto altitude = std::min(grid.altitudes[index] + noise[(x & 0xFF) * 256 + (z & 0xFF)], 0xFF);
+			const auto& material = countries[country].materials[altitude];
+			first = std::min<std::size_t>(static_cast<uint8_t>(material.indices[0]), materialCount - 1);
+			second = std::min<std::size_t>(static_cast<uint8_t>(material.indices[1]), materialCount - 1);
+			blend = static_cast<uint8_t>(material.coefficient) / 255.0f;
+		}
+		const auto* from = &filteredMaterials[(first * tileTexels + texel) * 3];
+		const auto* to = &filteredMaterials[(second * tileTexels + texel) * 3];
+		for (int channel = 0; channel < 3; channel++)
+		{
+			colour[channel] += weight * (from[channel] + (to[channel] - from[channel]) * blend);
+		}
+	};
+
+	for (uint16_t row = 0; row < TerrainBakedTileSize; row++)
+	{
+		const auto x = static_cast<uint16_t>(blockX * 16 + row / texelsPerCell);
+		const float fractionX = (row % texelsPerCell + 0.5f) / texelsPerCell;
+		for (uint16_t column = 0; column < TerrainBakedTileSize; column++)
+		{
+			const auto z = static_cast<uint16_t>(blockZ * 16 + column / texelsPerCell);
+			const float fractionZ = (column % texelsPerCell + 0.5f) / texelsPerCell;
+
+			// weights of the top left, top right, bottom left and bottom right corners over the triangle of the full
+			// level of detail mesh the texel is in
+			float weights[4];
+			if (!grid.properties[TerrainGridIndex(x, z)].split)
+			{
+				if (fractionX >= fractionZ)
+				{
+					weights[0] = 1.0f - fractionX;
+					weights[1] = fractionX - fractionZ;
+					weights[2] = 0.0f;
+					weights[3] = fractionZ;
+				}
+				else
+				{
+					weights[0] = 1.0f - fractionZ;
+					weights[1] = 0.0f;
+					weights[2] = fractionZ - fractionX;
+					weights[3] = fractionX;
+				}
+			}
+			else
+			{
+				if (fractionX + fractionZ <= 1.0f)
+				{
+					weights[0] = 1.0f - fractionX - fractionZ;
+					weights[1] = fractionX;
+					weights[2] = fractionZ;
+					weights[3] = 0.0f;
+				}
+				else
+				{
+					weights[0] = 0.0f;
+					weights[1] = 1.0f - fractionZ;
+					weights[2] = 1.0f - fractionX;
+					weights[3] = fractionX + fractionZ - 1.0f;
+				}
+			}
+
+			const std::size_t texel = row * TerrainBakedTileSize + column;
+			float colour[3] = {0.0f, 0.0f, 0.0f};
+			addCorner(x, z, texel, weights[0], colour);
+			addCorner(x + 1, z, texel, weights[1], colour);
+			addCorner(x, z + 1, texel, weights[2], colour);
+			addCorner(x + 1, z + 1, texel, weights[3], colour);
+			for (int channel = 0; channel < 3; channel++)
+			{
+				texels[texel * 4 + channel] = static_cast<uint8_t>(std::clamp(colour[channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+			}
+			texels[texel * 4 + 3] = 0xFF;
+		}
+	}
+}
@@ -9,16 +9,49 @@
 
 #pragma once
 
+#include <Span.h>
+
+#include <cstdint>
 #include <istream>
 #include <map>
 #include <memory>
 #include <streambuf>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
+namespace openblack
+{
+class MappedFile;
+}
+
 namespace openblack::pack
 {
 
+enum class PackOpenFlags : uint32_t
+{
+	None = 0,
+	/// Map the file read-only instead of reading it into memory. All returned spans point into the mapping.
+	MemoryMap = 1U << 0U,
+	/// Only resolve the look-up tables, textures, meshes and animations are extracted on first access
+	Lazy = 1U << 1U,
+	/// Extract textures and meshes over all hardware threads
+	Parallel = 1U << 2U,
+};
+
+inline PackOpenFlags operator|(PackOpenFlags a, PackOpenFlags b)
+{
+	return static_cast<PackOpenFlags>(static_cast<std::underlying_type<PackOpenFlags>::type>(a) |
+	                                  static_cast<std::underlying_type<PackOpenFlags>::type>(b));
+}
+
+inline PackOpenFlags operator&(PackOpenFlags a, PackOpenFlags b)
+{
+	return static_cast<PackOpenFlags>(static_cast<std::underlying_type<PackOpenFlags>::type>(a) &
+	                                  static_cast<std::underlying_type<PackOpenFlags>::type>(b));
+}
+
 struct InfoBlockLookup
 {
 	uint32_t blockId;
@@ -81,7 +114,26 @@ struct G3DTexture
 {
 	G3DTextureHeader header;
 	DdsHeader ddsHeader;
-	std::vector<uint8_t> ddsData;
+	/// Texel data, points into the texture block
+	Span<uint8_t> ddsData;
+};
+
+struct G3DAnimation
+{
+	/// ANM header, points into the Body block
+	Span<uint8_t> header;
+	/// Keyframe data, points into the JulienN block. Offsets within are relative to the start of the header.
+	Span<uint8_t> body;
+};
+
+struct PackBlock
+{
+	static constexpr uint32_t kNameSize = 32;
+
+	/// Null terminated name, as stored in the block header
+	char name[kNameSize];
+	/// Contents, into either the mapping, the file data or the created blocks
+	Span<uint8_t> data;
 };
 
 /**
@@ -89,29 +141,58 @@ struct G3DTexture
  */
 class PackFile
 {
+	friend class PackWriter;
+
 protected:
 	static constexpr const char kMagic[8] = {'L', 'i', 'O', 'n', 'H', 'e', 'A', 'd'};
+	static constexpr uint32_t kNoBlock = 0xFFFFFFFF;
 
 	/// True when a file has been loaded
 	bool _isLoaded;
 
+	/// True when entries are extracted on first access rather than on open
+	bool _isLazy;
+
+	/// True when extraction of all entries is spread over worker threads
+	bool _isParallel;
+
 	std::string _filename;
 
-	std::map<std::string, std::vector<uint8_t>> _blocks;
+	/// Read-only mapping of the file when opened with PackOpenFlags::MemoryMap
+	std::unique_ptr<MappedFile> _mappedFile;
+	/// Contents of the file when read into memory
+	std::vector<uint8_t> _fileData;
+	/// Contents of blocks created for writing
+	std::vector<std::vector<uint8_t>> _createdBlocks;
+
+	/// Block directory, in the order blocks were read or created
+	std::vector<PackBlock> _blocks;
+	/// Indices into the block directory sorted by name
+	std::vector<uint32_t> _blocksByName;
+	/// Index of the block named after each texture id in hexadecimal
+	std::unordered_map<uint32_t, uint32_t> _textureBlocks;
+	/// Index of block JulienN at N, kNoBlock where there is none
+	std::vector<uint32_t> _animationBlocks;
 	std::vector<InfoBlockLookup> _infoBlockLookup;
+	/// Index into the INFO look-up table of each texture id it names
+	std::unordered_map<uint32_t, uint32_t> _infoBlocks;
 	std::vector<BodyBlockLookup> _bodyBlockLookup;
-	/// Metadata and DDS formatted texture data
-	std::map<std::string, G3DTexture> _textures;
-	/// Bytes of l3d meshes
-	std::vector<std::vector<uint8_t>> _meshes;
-	/// Bytes of anm meshes
-	std::vector<std::vector<uint8_t>> _animations;
+	/// Offsets of the l3d meshes in the MESHES block
+	std::vector<uint32_t> _meshOffsets;
+	/// End of each l3d mesh in the MESHES block, the next distinct offset as deduplicated meshes share theirs
+	std::vector<uint32_t> _meshEnds;
+	/// Metadata and DDS formatted texture data, filled on access when lazy
+	mutable std::map<std::string, G3DTexture> _textures;
+	/// Bytes of l3d meshes, null until accessed when lazy
+	mutable std::vector<Span<uint8_t>> _meshes;
+	/// Header and keyframes of anm animations, null until accessed when lazy
+	mutable std::vector<G3DAnimation> _animations;
 
 	/// Error handling
-	void Fail(const std::string& msg);
+	void Fail(const std::string& msg) const;
 
-	/// Read blocks from pack
-	virtual void ReadBlocks();
+	/// Split the file contents into blocks
+	virtual void ReadBlocks(Span<uint8_t> data);
 
 	/// Write blocks to file
 	virtual void WriteBlocks(std::ostream& stream) const;
@@ -122,22 +203,47 @@ class PackFile
 	/// Parse Body Block for anim pack
 	virtual void ResolveBodyBlock();
 
+	/// Parse Mesh Block offset table
+	virtual void ResolveMeshBlock();
+
 	/// Extract Textures from all Blocks named in INFO Block
 	virtual void ExtractTexturesFromBlock();
 
+	/// Extract Meshes from all offsets of the Mesh Block
+	virtual void ExtractMeshesFromBlock();
+
 	/// Extract Animations from all Blocks named in Body Block
 	virtual void ExtractAnimationsFromBlock();
 
-	/// Parse Info Block
-	virtual void ResolveMeshBlock();
+	/// Extract a single texture from its block
+	[[nodiscard]] G3DTexture ExtractTexture(const PackBlock& block, uint32_t blockId) const;
+
+	/// Extract a single mesh from the Mesh Block
+	[[nodiscard]] Span<uint8_t> ExtractMesh(uint32_t index) const;
+
+	/// Extract a single animation from the Body Block and its JulienN block
+	[[nodiscard]] G3DAnimation ExtractAnimation(uint32_t index) const;
+
+	/// Append a block to the directory and to the texture or animation look-up tables
+	void IndexBlock(const std::string& name, Span<uint8_t> data);
+
+	/// Take ownership of a created block and add it to the blocks
+	void AddBlock(const std::string& name, std::vector<uint8_t>&& contents);
+
+	/// First index of the sorted directory whose name is not less than name
+	[[nodiscard]] std::vector<uint32_t>::const_iterator LowerBoundByName(const std::string& name) const;
+	[[nodiscard]] const PackBlock* FindBlock(const std::string& name) const;
+	[[nodiscard]] const PackBlock* FindTextureBlock(uint32_t blockId) const;
+	[[nodiscard]] const PackBlock* FindAnimationBlock(uint32_t index) const;
+	[[nodiscard]] const PackBlock& GetTextureBlock(uint32_t blockId) const;
 
 public:
 	PackFile();
 
-	virtual ~PackFile() = default;
+	virtual ~PackFile();
 
-	/// Read l3d file from the filesystem
-	void Open(const std::string& file);
+	/// Read pack file from the filesystem
+	void Open(const std::string& file, PackOpenFlags flags = PackOpenFlags::None);
 
 	/// Write pack file to path on the filesystem
 	void Write(const std::string& file);
@@ -155,18 +261,95 @@ class PackFile
 	void CreateBodyBlock();
 
 	[[nodiscard]] const std::string& GetFilename() const { return _filename; }
-	[[nodiscard]] const std::map<std::string, std::vector<uint8_t>>& GetBlocks() const { return _blocks; }
-	[[nodiscard]] bool HasBlock(const std::string& name) const { return _blocks.count(name); }
-	[[nodiscard]] const std::vector<uint8_t>& GetBlock(const std::string& name) const { return _blocks.at(name); }
+	[[nodiscard]] bool IsMapped() const { return static_cast<bool>(_mappedFile); }
+	[[nodiscard]] bool IsLazy() const { return _isLazy; }
+	[[nodiscard]] const std::vector<PackBlock>& GetBlocks() const { return _blocks; }
+	[[nodiscard]] bool HasBlock(const std::string& name) const { return FindBlock(name) != nullptr; }
+	[[nodiscard]] Span<uint8_t> GetBlock(const std::string& name) const;
 	[[nodiscard]] std::unique_ptr<std::istream> GetBlockAsStream(const std::string& name) const;
 	[[nodiscard]] const std::vector<InfoBlockLookup>& GetInfoBlockLookup() const { return _infoBlockLookup; }
 	[[nodiscard]] const std::vector<BodyBlockLookup>& GetBodyBlockLookup() const { return _bodyBlockLookup; }
+	/// When lazy, only holds the textures accessed so far
 	[[nodiscard]] const std::map<std::string, G3DTexture>& GetTextures() const { return _textures; }
-	[[nodiscard]] const G3DTexture& GetTexture(const std::string& name) const { return _textures.at(name); }
-	[[nodiscard]] const std::vector<std::vector<uint8_t>>& GetMeshes() const { return _meshes; }
-	[[nodiscard]] const std::vector<uint8_t>& GetMesh(uint32_t index) const { return _meshes[index]; }
-	[[nodiscard]] const std::vector<std::vector<uint8_t>>& GetAnimations() const { return _animations; }
-	[[nodiscard]] const std::vector<uint8_t>& GetAnimation(uint32_t index) const { return _animations[index]; }
+	[[nodiscard]] const G3DTexture& GetTexture(const std::string& name) const;
+	/// When lazy, meshes not accessed so far are null
+	[[nodiscard]] const std::vector<Span<uint8_t>>& GetMeshes() const { return _meshes; }
+	[[nodiscard]] Span<uint8_t> GetMesh(uint32_t index) const;
+	/// When lazy, animations not accessed so far are null
+	[[nodiscard]] const std::vector<G3DAnimation>& GetAnimations() const { return _animations; }
+	[[nodiscard]] const G3DAnimation& GetAnimation(uint32_t index) const;
+};
+
+/**
+  This class is used to write LionHead Packs files block by block straight to a stream
+
+  Block sizes and the MESHES offset table are back-patched once their contents have been written, so
+  payloads can be copied from their source in chunks without ever holding a whole block in memory.
+ */
+class PackWriter
+{
+protected:
+	std::ostream& _stream;
+
+	/// True between BeginBlock and EndBlock
+	bool _isInBlock;
+	/// Position of the size field in the header of the current block
+	std::streampos _blockSizePosition;
+	/// Position of the first byte of the current block
+	std::streampos _blockStart;
+
+	/// Position of the offset table in the current MESHES block
+	std::streampos _meshOffsetsPosition;
+	/// Offsets of the meshes added to the current MESHES block
+	std::vector<uint32_t> _meshOffsets;
+	/// Number of meshes announced in BeginMeshBlock
+	uint32_t _meshCount;
+
+	/// Error handling
+	void Fail(const std::string& msg) const;
+
+public:
+	/// Start a pack file on the stream by writing its magic number
+	explicit PackWriter(std::ostream& stream);
+
+	/// Write the header of a block whose size is patched by EndBlock
+	void BeginBlock(const std::string& name);
+
+	/// Append bytes to the current block
+	void Write(const void* data, std::size_t size);
+
+	/// Append size bytes read from source to the current block in fixed size chunks
+	void Write(std::istream& source, std::size_t size);
+
+	/// Patch the size of the current block
+	void EndBlock();
+
+	/// Write a whole block at once
+	void WriteBlock(const std::string& name, Span<uint8_t> contents);
+
+	/// Write INFO block from a look-up table
+	void WriteInfoBlock(const std::vector<InfoBlockLookup>& lookup);
+
+	/// Write a texture block, the texels are read from source
+	void WriteTextureBlock(const G3DTextureHeader& header, const DdsHeader& ddsHeader, std::istream& source);
+
+	/// Write Body block from the headers of each animation, in JulienN order
+	void WriteBodyBlock(const std::vector<Span<uint8_t>>& animationHeaders);
+
+	/// Start a MESHES block of meshCount meshes with a zeroed offset table
+	void BeginMeshBlock(uint32_t meshCount);
+
+	/// Append the next mesh to the MESHES block
+	void AddMesh(Span<uint8_t> mesh);
+
+	/// Append the next mesh to the MESHES block, size bytes are read from source
+	void AddMesh(std::istream& source, std::size_t size);
+
+	/// Point the next mesh of the MESHES block at the data of an identical mesh added before it
+	void AddMeshReference(uint32_t index);
+
+	/// Patch the offset table and size of the MESHES block
+	void EndMeshBlock();
 };
 
 } // namespace openblack::pack
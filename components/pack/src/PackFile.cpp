@@ -76,13 +76,22 @@
  *
  */
 
+#include <MappedFile.h>
 #include <PackFile.h>
+#include <ParallelFor.h>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstddef>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <stdexcept>
+#include <string_view>
 
 using namespace openblack::pack;
+using openblack::Span;
 
 namespace
 {
@@ -137,69 +146,146 @@ struct PackBlockHeader
 
 /// Magic Key Jean-Claude Cottier
 constexpr const char kBlockMagic[4] = {'M', 'K', 'J', 'C'};
+
 } // namespace
 
 /// Error handling
-void PackFile::Fail(const std::string& msg)
+void PackFile::Fail(const std::string& msg) const
 {
 	throw std::runtime_error("Pack Error: " + msg + "\nFilename: " + _filename);
 }
 
-void PackFile::ReadBlocks()
+void PackFile::ReadBlocks(Span<uint8_t> data)
 {
 	assert(!_isLoaded);
 
-	std::ifstream input(_filename, std::ios::binary);
-
-	if (!input.is_open())
+	if (data.size() < sizeof(kMagic) + sizeof(PackBlockHeader))
 	{
-		Fail("Could not open file.");
+		Fail("File too small to be a valid Pack file.");
 	}
 
-	// Total file size
-	std::size_t fsize = 0;
-	if (input.seekg(0, std::ios_base::end))
+	// First 8 bytes
+	if (std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0)
 	{
-		fsize = static_cast<std::size_t>(input.tellg());
-		input.seekg(0);
+		Fail("Unrecognized Pack header");
 	}
 
-	char magic[sizeof(kMagic)];
-	if (fsize < sizeof(magic) + sizeof(PackBlockHeader))
+	std::size_t offset = sizeof(kMagic);
+	PackBlockHeader header;
+	while (data.size() - sizeof(PackBlockHeader) > offset)
 	{
-		Fail("File too small to be a valid Pack file.");
+		std::memcpy(&header, data.data() + offset, sizeof(PackBlockHeader));
+		offset += sizeof(PackBlockHeader);
+
+		if (header.blockSize > data.size() - offset)
+		{
+			Fail("File not evenly split into whole blocks.");
+		}
+
+		const auto nameEnd = std::find(header.blockName, header.blockName + sizeof(header.blockName) - 1, '\0');
+		IndexBlock(std::string(header.blockName, nameEnd), data.subspan(offset, header.blockSize));
+		offset += header.blockSize;
 	}
 
-	// First 8 bytes
-	input.read(reinterpret_cast<char*>(&magic), sizeof(magic));
-	if (std::memcmp(&magic, kMagic, sizeof(magic)) != 0)
+	// Sort once, duplicates end up next to each other
+	auto byName = [this](uint32_t a, uint32_t b) {
+		return std::strncmp(_blocks[a].name, _blocks[b].name, PackBlock::kNameSize) < 0;
+	};
+	_blocksByName.resize(_blocks.size());
+	for (uint32_t i = 0; i < _blocksByName.size(); ++i)
 	{
-		Fail("Unrecognized Pack header");
+		_blocksByName[i] = i;
 	}
-
-	if (fsize < static_cast<std::size_t>(input.tellg()) + sizeof(PackBlockHeader))
+	std::sort(_blocksByName.begin(), _blocksByName.end(), byName);
+	auto duplicate = std::adjacent_find(_blocksByName.begin(), _blocksByName.end(),
+	                                    [&byName](uint32_t a, uint32_t b) { return !byName(a, b); });
+	if (duplicate != _blocksByName.end())
 	{
-		Fail("File too small to contain any blocks.");
+		Fail(std::string("Duplicate block name: ") + _blocks[*duplicate].name);
 	}
+}
 
-	PackBlockHeader header;
-	while (fsize - sizeof(PackBlockHeader) > static_cast<std::size_t>(input.tellg()))
+void PackFile::IndexBlock(const std::string& name, Span<uint8_t> data)
+{
+	const auto index = static_cast<uint32_t>(_blocks.size());
+
+	PackBlock block {};
+	std::snprintf(block.name, sizeof(block.name), "%s", name.c_str());
+	block.data = data;
+	_blocks.push_back(block);
+
+	// Texture blocks are named after their id as lowercase hexadecimal without leading zeros
+	const auto isHex = [](char c) { return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'); };
+	if (!name.empty() && name.size() <= 8 && (name[0] != '0' || name.size() == 1) &&
+	    std::all_of(name.begin(), name.end(), isHex))
 	{
-		input.read(reinterpret_cast<char*>(&header), sizeof(PackBlockHeader));
+		_textureBlocks[static_cast<uint32_t>(std::strtoul(name.c_str(), nullptr, 16))] = index;
+		return;
+	}
 
-		if (_blocks.count(header.blockName) > 0)
+	// Animation blocks are named JulienN with N in decimal
+	constexpr std::string_view animationPrefix = "Julien";
+	const auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+	const auto digits = name.size() - std::min(name.size(), animationPrefix.size());
+	if (digits > 0 && digits <= 9 && name.compare(0, animationPrefix.size(), animationPrefix) == 0 &&
+	    (name[animationPrefix.size()] != '0' || digits == 1) &&
+	    std::all_of(name.begin() + animationPrefix.size(), name.end(), isDigit))
+	{
+		const auto animation = static_cast<uint32_t>(std::strtoul(name.c_str() + animationPrefix.size(), nullptr, 10));
+		if (animation >= _animationBlocks.size())
 		{
-			Fail(std::string("Duplicate block name: ") + header.blockName);
+			_animationBlocks.resize(animation + 1, kNoBlock);
 		}
+		_animationBlocks[animation] = index;
+	}
+}
+
+std::vector<uint32_t>::const_iterator PackFile::LowerBoundByName(const std::string& name) const
+{
+	return std::lower_bound(_blocksByName.begin(), _blocksByName.end(), name,
+	                        [this](uint32_t index, const std::string& value) {
+		                        return std::strncmp(_blocks[index].name, value.c_str(), PackBlock::kNameSize) < 0;
+	                        });
+}
+
+const PackBlock* PackFile::FindBlock(const std::string& name) const
+{
+	if (name.size() >= PackBlock::kNameSize)
+	{
+		return nullptr;
+	}
+
+	auto found = LowerBoundByName(name);
+	if (found == _blocksByName.end() || name != _blocks[*found].name)
+	{
+		return nullptr;
+	}
+	return &_blocks[*found];
+}
+
+const PackBlock* PackFile::FindTextureBlock(uint32_t blockId) const
+{
+	auto found = _textureBlocks.find(blockId);
+	return found == _textureBlocks.end() ? nullptr : &_blocks[found->second];
+}
 
-		_blocks[std::string(header.blockName)] = std::vector<uint8_t>(header.blockSize);
-		input.read(reinterpret_cast<char*>(_blocks[header.blockName].data()), header.blockSize);
+const PackBlock* PackFile::FindAnimationBlock(uint32_t index) const
+{
+	if (index >= _animationBlocks.size() || _animationBlocks[index] == kNoBlock)
+	{
+		return nullptr;
 	}
+	return &_blocks[_animationBlocks[index]];
+}
 
-	if (fsize < static_cast<std::size_t>(input.tellg()))
+Span<uint8_t> PackFile::GetBlock(const std::string& name) const
+{
+	auto block = FindBlock(name);
+	if (block == nullptr)
 	{
-		Fail("File not evenly split into whole blocks.");
+		throw std::out_of_range("No block named " + name);
 	}
+	return block->data;
 }
 
 void PackFile::ResolveInfoBlock()
@@ -215,9 +301,20 @@ void PackFile::ResolveInfoBlock()
 	uint32_t totalTextures;
 	stream.read(reinterpret_cast<char*>(&totalTextures), sizeof(uint32_t));
 
+	if (data.size() < sizeof(totalTextures) + totalTextures * sizeof(InfoBlockLookup))
+	{
+		Fail("INFO block too small for its look-up table");
+	}
+
 	// Read lookup
 	_infoBlockLookup.resize(totalTextures);
 	stream.read(reinterpret_cast<char*>(_infoBlockLookup.data()), _infoBlockLookup.size() * sizeof(_infoBlockLookup[0]));
+
+	_infoBlocks.reserve(_infoBlockLookup.size());
+	for (uint32_t i = 0; i < totalTextures; ++i)
+	{
+		_infoBlocks.emplace(_infoBlockLookup[i].blockId, i);
+	}
 }
 
 void PackFile::ResolveBodyBlock()
@@ -241,85 +338,127 @@ void PackFile::ResolveBodyBlock()
 	uint32_t totalAnimations;
 	stream.read(reinterpret_cast<char*>(&totalAnimations), sizeof(uint32_t));
 
+	if (data.size() < sizeof(kBlockMagic) + sizeof(totalAnimations) + totalAnimations * sizeof(BodyBlockLookup))
+	{
+		Fail("Body block too small for its look-up table");
+	}
+
 	// Read lookup offsets
 	_bodyBlockLookup.resize(totalAnimations);
 	stream.read(reinterpret_cast<char*>(_bodyBlockLookup.data()), _bodyBlockLookup.size() * sizeof(_bodyBlockLookup[0]));
+
+	_animations.resize(_bodyBlockLookup.size());
 }
 
-void PackFile::ExtractTexturesFromBlock()
+G3DTexture PackFile::ExtractTexture(const PackBlock& block, uint32_t blockId) const
 {
 	G3DTextureHeader header;
-	constexpr uint32_t blockNameSize = 0x20;
-	char blockName[blockNameSize];
-	for (const auto& item : _infoBlockLookup)
+	DdsHeader ddsHeader;
+
+	const auto& data = block.data;
+	if (data.size() < sizeof(header) + sizeof(ddsHeader))
 	{
-		// Convert int id to string representation as hexadecimal key
-		std::snprintf(blockName, sizeof(blockName), "%x", item.blockId);
+		Fail(std::string("Texture block \"") + block.name + "\" too small.");
+	}
 
-		if (!HasBlock(blockName))
-		{
-			Fail(std::string("Required texture block \"") + blockName + "\" missing.");
-		}
+	std::memcpy(&header, data.data(), sizeof(header));
 
-		auto stream = GetBlockAsStream(blockName);
+	if (header.id != blockId)
+	{
+		Fail("Texture block id is not the same as block id");
+	}
 
-		stream->read(reinterpret_cast<char*>(&header), sizeof(header));
-		std::vector<uint8_t> dds(header.size);
-		stream->read(reinterpret_cast<char*>(dds.data()), dds.size() * sizeof(dds[0]));
+	std::memcpy(&ddsHeader, data.data() + sizeof(header), sizeof(ddsHeader));
 
-		if (header.id != item.blockId)
-		{
-			Fail("Texture block id is not the same as block id");
-		}
+	// TODO(bwrsandman) the extra sizeof(uint32_t) is unaccounted for
+	if (header.ddsSize - sizeof(ddsHeader) - sizeof(uint32_t) != ddsHeader.pitchOrLinearSize)
+	{
+		Fail("Size in header does not match according to DDS signature");
+	}
 
-		if (_textures.count(blockName) > 0)
-		{
-			Fail("Duplicate texture extracted");
-		}
+	const auto texelsOffset = sizeof(header) + sizeof(ddsHeader);
+	if (data.size() - texelsOffset < ddsHeader.pitchOrLinearSize)
+	{
+		Fail(std::string("Texture block \"") + block.name + "\" too small for its DDS texels.");
+	}
 
-		imemstream ddsStream(reinterpret_cast<const char*>(dds.data()), dds.size());
+	return {header, ddsHeader, data.subspan(texelsOffset, ddsHeader.pitchOrLinearSize)};
+}
 
-		DdsHeader ddsHeader;
-		ddsStream.read(reinterpret_cast<char*>(&ddsHeader), sizeof(DdsHeader));
+const PackBlock& PackFile::GetTextureBlock(uint32_t blockId) const
+{
+	auto block = FindTextureBlock(blockId);
+	if (block == nullptr)
+	{
+		constexpr uint32_t blockNameSize = 0x20;
+		char blockName[blockNameSize];
+		std::snprintf(blockName, sizeof(blockName), "%x", blockId);
+		Fail(std::string("Required texture block \"") + blockName + "\" missing.");
+	}
+	return *block;
+}
 
-		// TODO(bwrsandman) the extra sizeof(uint32_t) is unaccounted for
-		if (header.ddsSize - sizeof(ddsHeader) - sizeof(uint32_t) != ddsHeader.pitchOrLinearSize)
+void PackFile::ExtractTexturesFromBlock()
+{
+	if (_isParallel)
+	{
+		// Validate every block on the workers, then insert in look-up order
+		std::vector<const PackBlock*> blocks(_infoBlockLookup.size());
+		std::vector<G3DTexture> textures(_infoBlockLookup.size());
+		ParallelFor(_infoBlockLookup.size(), [this, &blocks, &textures](std::size_t i) {
+			blocks[i] = &GetTextureBlock(_infoBlockLookup[i].blockId);
+			textures[i] = ExtractTexture(*blocks[i], _infoBlockLookup[i].blockId);
+		});
+
+		for (std::size_t i = 0; i < blocks.size(); ++i)
 		{
-			Fail("Size in header does not match according to DDS signature");
+			if (!_textures.emplace(blocks[i]->name, textures[i]).second)
+			{
+				Fail("Duplicate texture extracted");
+			}
 		}
+		return;
+	}
 
-		std::vector<uint8_t> dssTexels(ddsHeader.pitchOrLinearSize);
-		ddsStream.read(reinterpret_cast<char*>(dssTexels.data()), dssTexels.size());
-
-		_textures[blockName] = {header, ddsHeader, dssTexels};
+	for (const auto& item : _infoBlockLookup)
+	{
+		const auto& block = GetTextureBlock(item.blockId);
+		if (!_textures.emplace(block.name, ExtractTexture(block, item.blockId)).second)
+		{
+			Fail("Duplicate texture extracted");
+		}
 	}
 }
 
-void PackFile::ExtractAnimationsFromBlock()
+G3DAnimation PackFile::ExtractAnimation(uint32_t index) const
 {
-	auto data = GetBlock("Body");
-	imemstream stream(reinterpret_cast<const char*>(data.data()), data.size());
-
-	// Read lookup
 	constexpr uint32_t blockNameSize = 0x20;
 	constexpr uint32_t animationHeaderSize = 0x54;
 
-	char blockName[blockNameSize];
-	_animations.resize(_bodyBlockLookup.size());
-	for (uint32_t i = 0; i < _bodyBlockLookup.size(); ++i)
+	auto data = GetBlock("Body");
+
+	auto block = FindAnimationBlock(index);
+	if (block == nullptr)
 	{
-		snprintf(blockName, blockNameSize, "Julien%d", i);
-		if (!HasBlock(blockName))
-		{
-			Fail(std::string("Required texture block \"") + blockName + "\" missing.");
-		}
+		char blockName[blockNameSize];
+		snprintf(blockName, blockNameSize, "Julien%d", index);
+		Fail(std::string("Required texture block \"") + blockName + "\" missing.");
+	}
+
+	const auto offset = _bodyBlockLookup[index].offset;
+	if (offset > data.size() || data.size() - offset < animationHeaderSize)
+	{
+		Fail(std::string("Animation header of \"") + block->name + "\" out of Body block bounds.");
+	}
 
-		auto animationData = GetBlock(blockName);
-		_animations[i].resize(animationHeaderSize + animationData.size());
+	return {data.subspan(offset, animationHeaderSize), block->data};
+}
 
-		stream.seekg(_bodyBlockLookup[i].offset);
-		stream.read(reinterpret_cast<char*>(_animations[i].data()), animationHeaderSize);
-		memcpy(_animations[i].data() + animationHeaderSize, animationData.data(), animationData.size());
+void PackFile::ExtractAnimationsFromBlock()
+{
+	for (uint32_t i = 0; i < _bodyBlockLookup.size(); ++i)
+	{
+		_animations[i] = ExtractAnimation(i);
 	}
 }
 
@@ -342,15 +481,51 @@ void PackFile::ResolveMeshBlock()
 
 	uint32_t meshCount;
 	stream.read(reinterpret_cast<char*>(&meshCount), sizeof(meshCount));
-	std::vector<uint32_t> meshOffsets(meshCount);
-	stream.read(reinterpret_cast<char*>(meshOffsets.data()), meshOffsets.size() * sizeof(meshOffsets[0]));
+	if (data.size() < sizeof(kBlockMagic) + sizeof(meshCount) + meshCount * sizeof(uint32_t))
+	{
+		Fail("MESHES block too small for its offset table");
+	}
+	_meshOffsets.resize(meshCount);
+	stream.read(reinterpret_cast<char*>(_meshOffsets.data()), _meshOffsets.size() * sizeof(_meshOffsets[0]));
+
+	// Deduplicated meshes share an offset, so a mesh ends at the next greater offset rather than the next entry
+	std::vector<uint32_t> sortedOffsets(_meshOffsets);
+	std::sort(sortedOffsets.begin(), sortedOffsets.end());
+	_meshEnds.resize(_meshOffsets.size());
+	for (std::size_t i = 0; i < _meshOffsets.size(); ++i)
+	{
+		auto next = std::upper_bound(sortedOffsets.begin(), sortedOffsets.end(), _meshOffsets[i]);
+		_meshEnds[i] = next == sortedOffsets.end() ? static_cast<uint32_t>(data.size()) : *next;
+	}
+
+	_meshes.resize(_meshOffsets.size());
+}
+
+Span<uint8_t> PackFile::ExtractMesh(uint32_t index) const
+{
+	auto data = GetBlock("MESHES");
+
+	auto end = _meshEnds[index];
+	if (_meshOffsets[index] > end || end > data.size())
+	{
+		Fail("Mesh offsets out of MESHES block bounds");
+	}
+
+	return data.subspan(_meshOffsets[index], end - _meshOffsets[index]);
+}
+
+void PackFile::ExtractMeshesFromBlock()
+{
+	if (_isParallel)
+	{
+		ParallelFor(_meshOffsets.size(),
+		            [this](std::size_t i) { _meshes[i] = ExtractMesh(static_cast<uint32_t>(i)); });
+		return;
+	}
 
-	_meshes.resize(meshOffsets.size());
-	for (std::size_t i = 0; i < _meshes.size(); i++)
+	for (uint32_t i = 0; i < _meshOffsets.size(); i++)
 	{
-		auto size = (i == _meshes.size() - 1 ? data.size() : meshOffsets[i + 1]) - meshOffsets[i];
-		_meshes[i].resize(size);
-		stream.read(reinterpret_cast<char*>(_meshes[i].data()), _meshes[i].size() * sizeof(_meshes[i][0]));
+		_meshes[i] = ExtractMesh(i);
 	}
 }
 
@@ -358,19 +533,31 @@ void PackFile::WriteBlocks(std::ostream& stream) const
 {
 	assert(!_isLoaded);
 
-	// Magic number
-	stream.write(kMagic, sizeof(kMagic));
+	PackWriter writer(stream);
 
-	PackBlockHeader header;
+	for (auto& block : _blocks)
+	{
+		writer.WriteBlock(block.name, block.data);
+	}
+}
 
-	for (auto& [name, contents] : _blocks)
+void PackFile::AddBlock(const std::string& name, std::vector<uint8_t>&& contents)
+{
+	if (name.size() >= PackBlock::kNameSize)
 	{
-		std::snprintf(header.blockName, sizeof(header.blockName), "%s", name.c_str());
-		header.blockSize = static_cast<uint32_t>(contents.size() * sizeof(contents[0]));
+		Fail("Block name \"" + name + "\" too long");
+	}
 
-		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
-		stream.write(reinterpret_cast<const char*>(contents.data()), header.blockSize);
+	auto byName = LowerBoundByName(name);
+	if (byName != _blocksByName.end() && name == _blocks[*byName].name)
+	{
+		Fail("Duplicate block name: " + name);
 	}
+	_blocksByName.insert(byName, static_cast<uint32_t>(_blocks.size()));
+
+	// Moving the vector keeps its storage, so the view stays valid as more blocks are added
+	_createdBlocks.emplace_back(std::move(contents));
+	IndexBlock(name, _createdBlocks.back());
 }
 
 void PackFile::CreateTextureBlocks()
@@ -410,13 +597,15 @@ void PackFile::CreateMeshBlock()
 			offset += _meshes[i].size();
 		}
 		contents.resize(offset);
+		// Resizing may have moved the table
+		meshOffsets = reinterpret_cast<uint32_t*>(&contents[sizeof(kBlockMagic) + sizeof(meshCount)]);
 		for (size_t i = 0; i < _meshes.size(); ++i)
 		{
 			std::memcpy(&contents[meshOffsets[i]], _meshes[i].data(), _meshes[i].size() * sizeof(_meshes[i][0]));
 		}
 	}
 
-	_blocks["MESHES"] = std::move(contents);
+	AddBlock("MESHES", std::move(contents));
 }
 
 void PackFile::CreateInfoBlock()
@@ -437,7 +626,7 @@ void PackFile::CreateInfoBlock()
 
 	std::memcpy(contents.data() + offset, _infoBlockLookup.data(), _infoBlockLookup.size() * sizeof(_infoBlockLookup[0]));
 
-	_blocks["INFO"] = std::move(contents);
+	AddBlock("INFO", std::move(contents));
 }
 
 void PackFile::CreateBodyBlock()
@@ -449,30 +638,75 @@ void PackFile::CreateBodyBlock()
 
 	std::vector<uint8_t> contents;
 
-	_blocks["Body"] = std::move(contents);
+	AddBlock("Body", std::move(contents));
 }
 
 PackFile::PackFile()
     : _isLoaded(false)
+    , _isLazy(false)
+    , _isParallel(false)
 {
 }
 
-void PackFile::Open(const std::string& file)
+PackFile::~PackFile() = default;
+
+void PackFile::Open(const std::string& file, PackOpenFlags flags)
 {
+	assert(!_isLoaded);
+
 	_filename = file;
-	ReadBlocks();
+
+	Span<uint8_t> data;
+	if ((flags & PackOpenFlags::MemoryMap) == PackOpenFlags::MemoryMap)
+	{
+		_mappedFile = std::make_unique<MappedFile>();
+		if (!_mappedFile->Open(_filename))
+		{
+			Fail("Could not map file.");
+		}
+		data = Span<uint8_t>(_mappedFile->GetData(), _mappedFile->GetSize());
+	}
+	else
+	{
+		std::ifstream input(_filename, std::ios::binary);
+
+		if (!input.is_open())
+		{
+			Fail("Could not open file.");
+		}
+
+		// Total file size
+		if (input.seekg(0, std::ios_base::end))
+		{
+			_fileData.resize(static_cast<std::size_t>(input.tellg()));
+			input.seekg(0);
+		}
+		input.read(reinterpret_cast<char*>(_fileData.data()), _fileData.size());
+		data = _fileData;
+	}
+
+	ReadBlocks(data);
+	_isLazy = (flags & PackOpenFlags::Lazy) == PackOpenFlags::Lazy;
+	_isParallel = (flags & PackOpenFlags::Parallel) == PackOpenFlags::Parallel;
 	// Mesh pack
 	if (HasBlock("INFO"))
 	{
 		ResolveInfoBlock();
-		ExtractTexturesFromBlock();
 		ResolveMeshBlock();
+		if (!_isLazy)
+		{
+			ExtractTexturesFromBlock();
+			ExtractMeshesFromBlock();
+		}
 	}
 	// Anim pack
 	if (HasBlock("Body"))
 	{
 		ResolveBodyBlock();
-		ExtractAnimationsFromBlock();
+		if (!_isLazy)
+		{
+			ExtractAnimationsFromBlock();
+		}
 	}
 	_isLoaded = true;
 }
@@ -495,6 +729,245 @@ void PackFile::Write(const std::string& file)
 
 std::unique_ptr<std::istream> PackFile::GetBlockAsStream(const std::string& name) const
 {
-	auto& data = GetBlock(name);
+	auto data = GetBlock(name);
 	return std::make_unique<imemstream>(reinterpret_cast<const char*>(data.data()), data.size());
 }
+
+const G3DTexture& PackFile::GetTexture(const std::string& name) const
+{
+	auto texture = _textures.find(name);
+	if (texture != _textures.end() || !_isLazy)
+	{
+		return _textures.at(name);
+	}
+
+	const auto blockId = static_cast<uint32_t>(std::strtoul(name.c_str(), nullptr, 16));
+	const auto block = FindTextureBlock(blockId);
+	if (block == nullptr || name != block->name || _infoBlocks.find(blockId) == _infoBlocks.end())
+	{
+		Fail("Texture \"" + name + "\" not in INFO block");
+	}
+
+	return _textures.emplace(name, ExtractTexture(*block, blockId)).first->second;
+}
+
+Span<uint8_t> PackFile::GetMesh(uint32_t index) const
+{
+	auto& mesh = _meshes.at(index);
+	if (mesh.data() == nullptr)
+	{
+		mesh = ExtractMesh(index);
+	}
+	return mesh;
+}
+
+const G3DAnimation& PackFile::GetAnimation(uint32_t index) const
+{
+	auto& animation = _animations.at(index);
+	if (animation.header.data() == nullptr)
+	{
+		animation = ExtractAnimation(index);
+	}
+	return animation;
+}
+
+PackWriter::PackWriter(std::ostream& stream)
+    : _stream(stream)
+    , _isInBlock(false)
+    , _meshCount(0)
+{
+	// Magic number
+	_stream.write(PackFile::kMagic, sizeof(PackFile::kMagic));
+}
+
+/// Error handling
+void PackWriter::Fail(const std::string& msg) const
+{
+	throw std::runtime_error("Pack Error: " + msg);
+}
+
+void PackWriter::BeginBlock(const std::string& name)
+{
+	if (_isInBlock)
+	{
+		Fail("Block \"" + name + "\" started before the previous block was ended");
+	}
+	if (name.size() >= PackBlockHeader::blockNameSize)
+	{
+		Fail("Block name \"" + name + "\" too long");
+	}
+
+	PackBlockHeader header {};
+	std::snprintf(header.blockName, sizeof(header.blockName), "%s", name.c_str());
+	header.blockSize = 0;
+
+	_blockSizePosition = _stream.tellp() + static_cast<std::streamoff>(offsetof(PackBlockHeader, blockSize));
+	_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	_blockStart = _stream.tellp();
+	_isInBlock = true;
+}
+
+void PackWriter::Write(const void* data, std::size_t size)
+{
+	assert(_isInBlock);
+	_stream.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+}
+
+void PackWriter::Write(std::istream& source, std::size_t size)
+{
+	assert(_isInBlock);
+
+	std::array<char, 0x10000> buffer;
+	while (size > 0)
+	{
+		const auto chunk = std::min(size, buffer.size());
+		source.read(buffer.data(), static_cast<std::streamsize>(chunk));
+		if (static_cast<std::size_t>(source.gcount()) != chunk)
+		{
+			Fail("Source ended before all of its contents were written");
+		}
+		_stream.write(buffer.data(), static_cast<std::streamsize>(chunk));
+		size -= chunk;
+	}
+}
+
+void PackWriter::EndBlock()
+{
+	assert(_isInBlock);
+
+	const auto end = _stream.tellp();
+	const auto size = static_cast<uint32_t>(end - _blockStart);
+
+	_stream.seekp(_blockSizePosition);
+	_stream.write(reinterpret_cast<const char*>(&size), sizeof(size));
+	_stream.seekp(end);
+	_isInBlock = false;
+
+	if (!_stream)
+	{
+		Fail("Could not write to file.");
+	}
+}
+
+void PackWriter::WriteBlock(const std::string& name, Span<uint8_t> contents)
+{
+	BeginBlock(name);
+	Write(contents.data(), contents.size() * sizeof(contents[0]));
+	EndBlock();
+}
+
+void PackWriter::WriteInfoBlock(const std::vector<InfoBlockLookup>& lookup)
+{
+	const auto totalTextures = static_cast<uint32_t>(lookup.size());
+
+	BeginBlock("INFO");
+	Write(&totalTextures, sizeof(totalTextures));
+	Write(lookup.data(), lookup.size() * sizeof(lookup[0]));
+	EndBlock();
+}
+
+void PackWriter::WriteTextureBlock(const G3DTextureHeader& header, const DdsHeader& ddsHeader, std::istream& source)
+{
+	constexpr uint32_t blockNameSize = 0x20;
+	char blockName[blockNameSize];
+	// Convert int id to string representation as hexadecimal key
+	std::snprintf(blockName, sizeof(blockName), "%x", header.id);
+
+	BeginBlock(blockName);
+	Write(&header, sizeof(header));
+	Write(&ddsHeader, sizeof(ddsHeader));
+	Write(source, ddsHeader.pitchOrLinearSize);
+	EndBlock();
+}
+
+void PackWriter::WriteBodyBlock(const std::vector<Span<uint8_t>>& animationHeaders)
+{
+	const auto totalAnimations = static_cast<uint32_t>(animationHeaders.size());
+
+	BeginBlock("Body");
+	Write(kBlockMagic, sizeof(kBlockMagic));
+	Write(&totalAnimations, sizeof(totalAnimations));
+
+	// Headers follow the look-up table
+	auto offset = static_cast<uint32_t>(sizeof(kBlockMagic) + sizeof(totalAnimations) +
+	                                    animationHeaders.size() * sizeof(BodyBlockLookup));
+	for (const auto& header : animationHeaders)
+	{
+		BodyBlockLookup lookup {offset, 0};
+		Write(&lookup, sizeof(lookup));
+		offset += static_cast<uint32_t>(header.size());
+	}
+	for (const auto& header : animationHeaders)
+	{
+		Write(header.data(), header.size());
+	}
+	EndBlock();
+}
+
+void PackWriter::BeginMeshBlock(uint32_t meshCount)
+{
+	BeginBlock("MESHES");
+	Write(kBlockMagic, sizeof(kBlockMagic));
+	Write(&meshCount, sizeof(meshCount));
+
+	_meshCount = meshCount;
+	_meshOffsets.clear();
+	_meshOffsets.reserve(meshCount);
+	_meshOffsetsPosition = _stream.tellp();
+
+	// Placeholder offsets, patched in EndMeshBlock
+	const uint32_t zero = 0;
+	for (uint32_t i = 0; i < meshCount; ++i)
+	{
+		Write(&zero, sizeof(zero));
+	}
+}
+
+void PackWriter::AddMesh(Span<uint8_t> mesh)
+{
+	if (_meshOffsets.size() >= _meshCount)
+	{
+		Fail("More meshes added than announced");
+	}
+	_meshOffsets.push_back(static_cast<uint32_t>(_stream.tellp() - _blockStart));
+	Write(mesh.data(), mesh.size() * sizeof(mesh[0]));
+}
+
+void PackWriter::AddMesh(std::istream& source, std::size_t size)
+{
+	if (_meshOffsets.size() >= _meshCount)
+	{
+		Fail("More meshes added than announced");
+	}
+	_meshOffsets.push_back(static_cast<uint32_t>(_stream.tellp() - _blockStart));
+	Write(source, size);
+}
+
+void PackWriter::AddMeshReference(uint32_t index)
+{
+	if (_meshOffsets.size() >= _meshCount)
+	{
+		Fail("More meshes added than announced");
+	}
+	if (index >= _meshOffsets.size())
+	{
+		Fail("Mesh reference to a mesh not added yet");
+	}
+	_meshOffsets.push_back(_meshOffsets[index]);
+}
+
+void PackWriter::EndMeshBlock()
+{
+	if (_meshOffsets.size() != _meshCount)
+	{
+		Fail("Fewer meshes added than announced");
+	}
+
+	const auto end = _stream.tellp();
+	_stream.seekp(_meshOffsetsPosition);
+	_stream.write(reinterpret_cast<const char*>(_meshOffsets.data()),
+	              static_cast<std::streamsize>(_meshOffsets.size() * sizeof(_meshOffsets[0])));
+	_stream.seekp(end);
+
+	EndBlock();
+}
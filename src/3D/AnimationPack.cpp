@@ -29,7 +29,7 @@ void AnimationPack::LoadFromFile(const fs::path& path)
 
 	try
 	{
-		pack.Open(Game::instance()->GetFileSystem().FindPath(path).u8string());
+		pack.Open(Game::instance()->GetFileSystem().FindPath(path).u8string(), pack::PackOpenFlags::MemoryMap);
 	}
 	catch (std::runtime_error& err)
 	{
@@ -41,8 +41,9 @@ void AnimationPack::LoadFromFile(const fs::path& path)
 	_animations.resize(pack.GetAnimations().size());
 	for (uint32_t i = 0; i < _animations.size(); i++)
 	{
+		const auto& [header, body] = animation[i];
 		_animations[i] = std::make_unique<L3DAnim>();
-		_animations[i]->LoadFromBuffer(animation[i]);
+		_animations[i]->LoadFromBuffer(header.data(), header.size(), body.data(), body.size());
 		spdlog::debug("{} animation with {} frames with duration {}", _animations[i]->GetName(),
 		              _animations[i]->GetFrames().size(), _animations[i]->GetDuration());
 	}
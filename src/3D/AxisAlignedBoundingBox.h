@@ -7,6 +7,10 @@
  * openblack is licensed under the GNU General Public License version 3.
  *****************************************************************************/
 
+#pragma once
+
+#include <glm/common.hpp>
+#include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
 
 namespace openblack
@@ -19,6 +23,16 @@ struct AxisAlignedBoundingBox
 
 	[[nodiscard]] inline glm::vec3 center() const { return (maxima + minima) * 0.5f; }
 	[[nodiscard]] inline glm::vec3 size() const { return maxima - minima; }
+
+	/// Smallest box around this one once transformed by an affine matrix
+	[[nodiscard]] inline AxisAlignedBoundingBox transformed(const glm::mat4& matrix) const
+	{
+		const glm::vec3 halfSize = size() * 0.5f;
+		const glm::vec3 transformedCenter = matrix * glm::vec4(center(), 1.0f);
+		const glm::vec3 extent = glm::abs(glm::vec3(matrix[0])) * halfSize.x + glm::abs(glm::vec3(matrix[1])) * halfSize.y +
+		                         glm::abs(glm::vec3(matrix[2])) * halfSize.z;
+		return {transformedCenter - extent, transformedCenter + extent};
+	}
 };
 
 } // namespace openblack
@@ -0,0 +1,57 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#pragma once
+
+#include "AxisAlignedBoundingBox.h"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <array>
+
+namespace openblack
+{
+
+/// View frustum as six world space planes pointing inwards
+struct Frustum
+{
+	std::array<glm::vec4, 6> planes;
+
+	/// Extract the planes from a view projection matrix. The near plane assumes a [-1, 1] depth range, which is
+	/// conservative when the renderer uses [0, 1].
+	explicit Frustum(const glm::mat4& viewProjection)
+	{
+		const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		planes = {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2};
+	}
+
+	/// False only if the box is entirely outside one of the planes
+	[[nodiscard]] inline bool Intersects(const AxisAlignedBoundingBox& box) const
+	{
+		for (const auto& plane : planes)
+		{
+			// corner of the box furthest along the plane normal
+			const glm::vec3 positive(plane.x >= 0.0f ? box.maxima.x : box.minima.x,
+			                         plane.y >= 0.0f ? box.maxima.y : box.minima.y,
+			                         plane.z >= 0.0f ? box.maxima.z : box.minima.z);
+			if (plane.x * positive.x + plane.y * positive.y + plane.z * positive.z + plane.w < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+} // namespace openblack
@@ -88,6 +88,24 @@ void L3DAnim::LoadFromBuffer(const std::vector<uint8_t>& data)
 	Load(anm);
 }
 
+void L3DAnim::LoadFromBuffer(const uint8_t* header, std::size_t headerSize, const uint8_t* keyframes,
+                             std::size_t keyframesSize)
+{
+	anm::ANMFile anm;
+
+	try
+	{
+		anm.Open(header, headerSize, keyframes, keyframesSize);
+	}
+	catch (std::runtime_error& err)
+	{
+		spdlog::error("Failed to open l3d animation from buffer: {}", err.what());
+		return;
+	}
+
+	Load(anm);
+}
+
 const std::vector<glm::mat4> L3DAnim::GetBoneMatrices(uint32_t time) const
 {
 	if (_frames.empty())
@@ -44,6 +44,7 @@ class L3DAnim
 	void Load(const anm::ANMFile& anm);
 	void LoadFromFile(const fs::path& path);
 	void LoadFromBuffer(const std::vector<uint8_t>& data);
+	void LoadFromBuffer(const uint8_t* header, std::size_t headerSize, const uint8_t* keyframes, std::size_t keyframesSize);
 
 	[[nodiscard]] const std::string& GetName() const { return _name; }
 	[[nodiscard]] uint32_t GetDuration() const { return _duration; }
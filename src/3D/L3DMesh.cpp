@@ -19,6 +19,7 @@
 #include <glm/matrix.hpp>
 #include <spdlog/spdlog.h>
 
+#include <cfloat>
 #include <stdexcept>
 
 using namespace openblack;
@@ -67,6 +68,19 @@ void L3DMesh::Load(const l3d::L3DFile& l3d)
 		_subMeshes[i] = std::make_unique<L3DSubMesh>(*this);
 		_subMeshes[i]->Load(l3d, i);
 	}
+
+	// Bounds of everything that is drawn, used to cull instances of the mesh
+	_boundingBox.maxima = glm::vec3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	_boundingBox.minima = glm::vec3(FLT_MAX, FLT_MAX, FLT_MAX);
+	for (const auto& subMesh : _subMeshes)
+	{
+		if (!subMesh->isPhysics())
+		{
+			const auto box = subMesh->GetBoundingBox();
+			_boundingBox.minima = glm::min(_boundingBox.minima, box.minima);
+			_boundingBox.maxima = glm::max(_boundingBox.maxima, box.maxima);
+		}
+	}
 	// TODO(bwrsandman): store vertex and index buffers at mesh level
 	bgfx::frame();
 }
@@ -90,12 +104,17 @@ void L3DMesh::LoadFromFile(const fs::path& path)
 }
 
 void L3DMesh::LoadFromBuffer(const std::vector<uint8_t>& data)
+{
+	LoadFromBuffer(data.data(), data.size() * sizeof(data[0]));
+}
+
+void L3DMesh::LoadFromBuffer(const uint8_t* data, std::size_t size)
 {
 	l3d::L3DFile l3d;
 
 	try
 	{
-		l3d.Open(data);
+		l3d.Open(data, size);
 	}
 	catch (std::runtime_error& err)
 	{
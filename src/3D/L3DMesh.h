@@ -85,12 +85,15 @@ class L3DMesh
 	void Load(const l3d::L3DFile& l3d);
 	void LoadFromFile(const fs::path& path);
 	void LoadFromBuffer(const std::vector<uint8_t>& data);
+	void LoadFromBuffer(const uint8_t* data, std::size_t size);
 
 	[[nodiscard]] uint8_t GetNumSubMeshes() const { return _subMeshes.size(); }
 	[[nodiscard]] const std::vector<std::unique_ptr<L3DSubMesh>>& GetSubMeshes() const { return _subMeshes; }
 	[[nodiscard]] const std::unordered_map<SkinId, std::unique_ptr<graphics::Texture2D>>& GetSkins() const { return _skins; }
 	[[nodiscard]] const std::vector<uint32_t>& GetBoneParents() const { return _bonesParents; }
 	[[nodiscard]] const std::vector<glm::mat4>& GetBoneMatrices() const { return _bonesDefaultMatrices; }
+	/// Union of the bounding boxes of all submeshes which are not physics
+	[[nodiscard]] const AxisAlignedBoundingBox& GetBoundingBox() const { return _boundingBox; }
 
 private:
 	l3d::L3DMeshFlags _flags;
@@ -100,6 +103,7 @@ class L3DMesh
 	std::vector<std::unique_ptr<L3DSubMesh>> _subMeshes;
 	std::vector<uint32_t> _bonesParents;
 	std::vector<glm::mat4> _bonesDefaultMatrices;
+	AxisAlignedBoundingBox _boundingBox;
 
 public:
 	[[nodiscard]] const std::string& GetDebugName() const { return _debugName; }
@@ -9,180 +9,110 @@
 
 #include "LandBlock.h"
 
-#include "Graphics/VertexBuffer.h"
 #include "LandIsland.h"
 
 #include <LNDFile.h>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 
 using namespace openblack;
 using namespace openblack::graphics;
 
-LandVertex::LandVertex(const glm::vec3& _position, const glm::vec3& _weight, uint32_t mat[8], uint32_t blend[3],
-                       uint8_t _lightLevel, float _alpha)
-    : position {_position.x, _position.y, _position.z}
-    , weight {_weight.x, _weight.y, _weight.z}
-    , firstMaterialID {static_cast<uint8_t>(mat[0]), static_cast<uint8_t>(mat[1]), static_cast<uint8_t>(mat[2])}
-    , secondMaterialID {static_cast<uint8_t>(mat[3]), static_cast<uint8_t>(mat[4]), static_cast<uint8_t>(mat[5])}
-    , materialBlendCoefficient {static_cast<uint8_t>(blend[0]), static_cast<uint8_t>(blend[1]), static_cast<uint8_t>(blend[2])}
-    , lightLevel {_lightLevel}
-    , waterAlpha {_alpha}
+VertexDecl LandBlock::GetVertexDecl()
 {
-}
-
-void LandBlock::BuildMesh(LandIsland& island)
-{
-	if (_mesh != nullptr)
-		_mesh.reset();
-
+	// both are normalized and scaled back to bytes in the shader, which reads them the same way on every backend
 	VertexDecl decl;
-	decl.reserve(7);
-	decl.emplace_back(VertexAttrib::Attribute::Position, 3, VertexAttrib::Type::Float);
-	// weight
-	decl.emplace_back(VertexAttrib::Attribute::TexCoord1, 3, VertexAttrib::Type::Float);
-	// first material id
-	decl.emplace_back(VertexAttrib::Attribute::Color1, 3, VertexAttrib::Type::Uint8);
-	// second material id
-	decl.emplace_back(VertexAttrib::Attribute::Color2, 3, VertexAttrib::Type::Uint8);
-	// material blend coefficient
-	decl.emplace_back(VertexAttrib::Attribute::TexCoord2, 3, VertexAttrib::Type::Uint8, true);
-	// light level, align to 4 bytes
+	decl.reserve(2);
+	// cell position, altitude and block index
+	decl.emplace_back(VertexAttrib::Attribute::Position, 4, VertexAttrib::Type::Uint8, true);
+	// light level, water alpha, stitch altitude, weight corner and level of detail
 	decl.emplace_back(VertexAttrib::Attribute::Color0, 4, VertexAttrib::Type::Uint8, true);
-	// water alpha
-	decl.emplace_back(VertexAttrib::Attribute::Color3, 1, VertexAttrib::Type::Float, true);
-
-	auto verts = buildVertexList(island);
-
-	auto vertexBuffer = new VertexBuffer("LandBlock", verts, decl);
-	_mesh = std::make_unique<Mesh>(vertexBuffer);
+	return decl;
 }
 
-const bgfx::Memory* LandBlock::buildVertexList(LandIsland& island)
+void LandBlock::BuildIndexList(uint16_t* indices, uint32_t cellCount, uint16_t firstVertex)
 {
-	// reserve 16*16 quads of 2 tris with 3 verts = 1536
-	const bgfx::Memory* verticesMem = bgfx::alloc(sizeof(LandVertex) * 1536);
-	auto vertices = (LandVertex*)verticesMem->data;
+	lnd::BuildTerrainIndices(indices, cellCount, firstVertex);
+}
 
-	auto countries = island.GetCountries();
+void LandBlock::BuildVertexList(const LandIsland& island, uint8_t blockIndex, LandVertex* vertices) const
+{
+	const lnd::LNDTerrainGrid grid {island.GetAltitudes(), island.GetCellProperties(), island.GetLuminosities()};
+	lnd::BuildTerrainVertices(grid, _block->blockX, _block->blockZ, blockIndex, vertices);
+}
 
-	// auto neighbourBlockR = island.GetBlock(glm::u8vec2(_block->blockX + 1, _block->blockZ));
-	// auto neighbourBlockUp = island.GetBlock(glm::u8vec2(_block->blockX, _block->blockZ + 1));
+void LandBlock::UpdateBounds(const LandIsland& island)
+{
+	const auto* altitudes = island.GetAltitudes();
+	const int bx = _block->blockX * 16;
+	const int bz = _block->blockZ * 16;
+	auto altitude = [altitudes, bx, bz](int x, int z) -> float {
+		return altitudes[LandIsland::GridIndex(bx + x, bz + z)];
+	};
 
-	// we'll loop through each cell, 16x16
-	// (the array is 17x17 but the 17th block is questionable data)
+	uint8_t lowest = 0xFF;
+	uint8_t highest = 0x00;
+	for (int x = 0; x < 17; x++)
+	{
+		auto index = LandIsland::GridIndex(bx + x, bz);
+		for (int z = 0; z < 17; z++, index++)
+		{
+			lowest = std::min(lowest, altitudes[index]);
+			highest = std::max(highest, altitudes[index]);
+		}
+	}
 
-	int bx = _block->blockX * 16;
-	int bz = _block->blockZ * 16;
+	_boundingBox.minima = glm::vec3(_block->mapX, lowest * LandIsland::HeightUnit, _block->mapZ);
+	_boundingBox.maxima = glm::vec3(_block->mapX + 16 * LandIsland::CellSize, highest * LandIsland::HeightUnit,
+	                                _block->mapZ + 16 * LandIsland::CellSize);
 
-	uint16_t i = 0;
-	for (int x = 0; x < 16; x++)
+	// compare every cell corner against the triangle of the coarse cell it falls in, which is split like the cell at its
+	// top left as BuildTerrainVertices does
+	const auto* properties = island.GetCellProperties();
+	_lodErrors[0] = 0.0f;
+	for (uint8_t lod = 1; lod < LodCount; lod++)
 	{
-		for (int z = 0; z < 16; z++)
+		const int step = 1 << lod;
+		float error = _lodErrors[lod - 1];
+		for (int x = 0; x <= 16; x++)
 		{
-			// top left
-			auto tl = island.GetCell(glm::u16vec2(bx + x + 0, bz + z + 0));
-			// top right
-			auto tr = island.GetCell(glm::u16vec2(bx + x + 1, bz + z + 0));
-			// bottom left
-			auto bl = island.GetCell(glm::u16vec2(bx + x + 0, bz + z + 1));
-			// bottom right
-			auto br = island.GetCell(glm::u16vec2(bx + x + 1, bz + z + 1));
-
-			// construct positions from cell altitudes
-			glm::vec3 pTL((x + 0) * LandIsland::CellSize, tl.altitude * LandIsland::HeightUnit,
-			              ((z + 0) * LandIsland::CellSize));
-			glm::vec3 pTR((x + 1) * LandIsland::CellSize, tr.altitude * LandIsland::HeightUnit,
-			              ((z + 0) * LandIsland::CellSize));
-			glm::vec3 pBL((x + 0) * LandIsland::CellSize, bl.altitude * LandIsland::HeightUnit,
-			              ((z + 1) * LandIsland::CellSize));
-			glm::vec3 pBR((x + 1) * LandIsland::CellSize, br.altitude * LandIsland::HeightUnit,
-			              ((z + 1) * LandIsland::CellSize));
-
-			auto tlMat = countries[tl.properties.country].materials[tl.altitude + island.GetNoise(bx + x + 0, bz + z + 0)];
-			auto trMat = countries[tr.properties.country].materials[tr.altitude + island.GetNoise(bx + x + 1, bz + z + 0)];
-			auto blMat = countries[bl.properties.country].materials[bl.altitude + island.GetNoise(bx + x + 0, bz + z + 1)];
-			auto brMat = countries[br.properties.country].materials[br.altitude + island.GetNoise(bx + x + 1, bz + z + 1)];
-
-			// TODO: this is temporary way for drawing landscape, should be moved to the renderer
-			// use a lambda so we're not repeating ourselves
-			auto getAlpha = [](lnd::LNDCell::Properties properties) {
-				if (properties.hasWater || properties.fullWater)
-					return 0.0f;
-				if (properties.coastLine)
-					return 0.5f;
-				return 1.0f;
-			};
-			auto make_vert = [&getAlpha](const glm::vec3& height, const glm::vec3& weight, lnd::LNDMapMaterial m[3],
-			                             const lnd::LNDCell& cell) -> LandVertex {
-				uint32_t mat[6] = {m[0].indices[0], m[1].indices[0], m[2].indices[0],
-				                   m[0].indices[1], m[1].indices[1], m[2].indices[1]};
-				uint32_t blend[3] = {m[0].coefficient, m[1].coefficient, m[2].coefficient};
-				return LandVertex(height, weight, mat, blend, cell.luminosity, getAlpha(cell.properties));
-			};
-
-			// cell splitting
-			// winding order = clockwise
-			if (!tl.properties.split)
-			{
-				// TR/BR/TL  # #
-				//             #
-				lnd::LNDMapMaterial trbrtl[3] = {tlMat, trMat, brMat};
-				vertices[i++] = make_vert(pTR, glm::vec3(0, 1, 0), trbrtl, tr);
-				vertices[i++] = make_vert(pBR, glm::vec3(0, 0, 1), trbrtl, br);
-				vertices[i++] = make_vert(pTL, glm::vec3(1, 0, 0), trbrtl, tl);
-
-				// BR/BL/TL  #
-				//           # #
-				lnd::LNDMapMaterial brbltl[3] = {tlMat, blMat, brMat};
-				vertices[i++] = make_vert(pBR, glm::vec3(0, 0, 1), brbltl, br);
-				vertices[i++] = make_vert(pBL, glm::vec3(0, 1, 0), brbltl, bl);
-				vertices[i++] = make_vert(pTL, glm::vec3(1, 0, 0), brbltl, tl);
-			}
-			else
+			const int x0 = std::min(x / step * step, 16 - step);
+			const float u = static_cast<float>(x - x0) / step;
+			for (int z = 0; z <= 16; z++)
 			{
-				// BL/TL/TR  # #
-				//           #
-				lnd::LNDMapMaterial bltltr[3] = {blMat, tlMat, trMat};
-				vertices[i++] = make_vert(pBL, glm::vec3(1, 0, 0), bltltr, bl);
-				vertices[i++] = make_vert(pTL, glm::vec3(0, 1, 0), bltltr, tl);
-				vertices[i++] = make_vert(pTR, glm::vec3(0, 0, 1), bltltr, tr);
-
-				// TR/BR/BL    #
-				//           # #
-				lnd::LNDMapMaterial trbrbl[3] = {blMat, brMat, trMat};
-				vertices[i++] = make_vert(pTR, glm::vec3(0, 0, 1), trbrbl, tr);
-				vertices[i++] = make_vert(pBR, glm::vec3(0, 1, 0), trbrbl, br);
-				vertices[i++] = make_vert(pBL, glm::vec3(1, 0, 0), trbrbl, bl);
+				const int z0 = std::min(z / step * step, 16 - step);
+				const float v = static_cast<float>(z - z0) / step;
+				const float topLeft = altitude(x0, z0);
+				const float topRight = altitude(x0 + step, z0);
+				const float bottomLeft = altitude(x0, z0 + step);
+				const float bottomRight = altitude(x0 + step, z0 + step);
+
+				float interpolated;
+				if (!properties[LandIsland::GridIndex(bx + x0, bz + z0)].split)
+				{
+					// diagonal from the top left to the bottom right corner
+					if (u >= v)
+						interpolated = topLeft + (topRight - topLeft) * u + (bottomRight - topRight) * v;
+					else
+						interpolated = topLeft + (bottomRight - bottomLeft) * u + (bottomLeft - topLeft) * v;
+				}
+				else
+				{
+					// diagonal from the top right to the bottom left corner
+					if (u + v <= 1.0f)
+						interpolated = topLeft + (topRight - topLeft) * u + (bottomLeft - topLeft) * v;
+					else
+						interpolated =
+						    bottomRight + (bottomRight - bottomLeft) * (u - 1.0f) + (bottomRight - topRight) * (v - 1.0f);
+				}
+				error = std::max(error, std::abs(altitude(x, z) - interpolated) * LandIsland::HeightUnit);
 			}
 		}
+		_lodErrors[lod] = error;
 	}
-
-	return verticesMem;
-}
-
-void LandBlock::Draw(graphics::RenderPass viewId, const ShaderProgram& program, bool cullBack) const
-{
-	glm::vec4 mapPosition = glm::vec4(_block->mapX, _block->mapZ, 0, 0);
-	program.SetUniformValue("u_blockPosition", &mapPosition);
-
-	constexpr auto defaultState = BGFX_STATE_WRITE_MASK | BGFX_STATE_DEPTH_TEST_LESS | BGFX_STATE_BLEND_ALPHA | BGFX_STATE_MSAA;
-
-	Mesh::DrawDesc desc = {
-	    /*viewId =*/viewId,
-	    /*program =*/program,
-	    /*count =*/_mesh->GetVertexBuffer().GetCount(),
-	    /*offset =*/0,
-	    /*instanceBuffer =*/nullptr,
-	    /*instanceStart =*/0,
-	    /*instanceCount =*/1,
-	    /*state =*/defaultState | (cullBack ? BGFX_STATE_CULL_CCW : BGFX_STATE_CULL_CW),
-	    /*rgba =*/0,
-	    /*skip =*/Mesh::SkipState::SkipNone,
-	    /*preserveState =*/false,
-	};
-	_mesh->Draw(desc);
 }
 
 const lnd::LNDCell* LandBlock::GetCells() const
@@ -9,57 +9,81 @@
 
 #pragma once
 
-#include "Graphics/Mesh.h"
-#include "Graphics/ShaderProgram.h"
+#include "AxisAlignedBoundingBox.h"
+#include "Graphics/VertexBuffer.h"
 
+#include <LNDTerrain.h>
 #include <glm/fwd.hpp>
 
+#include <array>
 #include <cstdint>
 
 namespace openblack
 {
 
-namespace lnd
-{
-struct LNDBlock;
-struct LNDCell;
-} // namespace lnd
+/// Corner of a cell, see lnd::LNDTerrainVertex
+using LandVertex = lnd::LNDTerrainVertex;
+
+class LandIsland;
 
-struct LandVertex
+/// Level of detail chosen for a block by LandIsland::SelectLods
+struct LandBlockLod
 {
-	float position[3];
-	float weight[3];                     // interpolated
-	uint8_t firstMaterialID[4];          // force alignment 4 bytes to prevent packing
-	uint8_t secondMaterialID[4];         // force alignment 4 bytes to prevent packing
-	uint8_t materialBlendCoefficient[4]; // force alignment 4 bytes to prevent
-	                                     // packing
-	uint8_t lightLevel[4];               // aligned to 4 bytes
-	float waterAlpha;
-
-	LandVertex(const glm::vec3& _position, const glm::vec3& _weight, uint32_t mat[6], uint32_t blend[3], uint8_t _lightLevel,
-	           float _alpha);
-};
+	enum Edge : uint8_t
+	{
+		NegativeX = 1U << 0U,
+		PositiveX = 1U << 1U,
+		NegativeZ = 1U << 2U,
+		PositiveZ = 1U << 3U,
+	};
 
-class LandIsland;
+	uint8_t level;             ///< 0 is the full mesh, every level halves the cells per side
+	uint8_t coarserNeighbours; ///< Edges whose neighbour uses level + 1 and must be stitched to
+};
 
 class LandBlock
 {
 public:
+	/// 16x16, 8x8, 4x4 and 2x2 cells
+	static constexpr uint8_t LodCount = 4;
+	/// Quads of 4 verts for every level of detail, stored one level after the other
+	static constexpr uint32_t VertexCount = lnd::TerrainBlockVertexCount;
+	/// 16*16 quads of 2 tris, the same for every block. Coarser levels use the beginning.
+	static constexpr uint32_t IndexCount = lnd::TerrainBlockIndexCount;
+
+	/// Layout of LandVertex
+	static graphics::VertexDecl GetVertexDecl();
+
+	[[nodiscard]] static constexpr uint32_t GetLodCellCount(uint8_t lod) { return (16U >> lod) * (16U >> lod); }
+	[[nodiscard]] static constexpr uint32_t GetLodVertexOffset(uint8_t lod)
+	{
+		return lod == 0 ? 0 : GetLodVertexOffset(lod - 1) + GetLodCellCount(lod - 1) * 4;
+	}
+
+	/// Fill the 6 indices of each of cellCount quads, the first quad starting at firstVertex
+	static void BuildIndexList(uint16_t* indices, uint32_t cellCount = 16 * 16, uint16_t firstVertex = 0);
+
 	LandBlock() = default;
-	void Draw(graphics::RenderPass viewId, const graphics::ShaderProgram& program, bool cullBack) const;
-	void BuildMesh(LandIsland& island);
+	/// Fill VertexCount vertices, only reads from the island so it is safe to call from worker threads
+	void BuildVertexList(const LandIsland& island, uint8_t blockIndex, LandVertex* vertices) const;
 
-	[[nodiscard]] const graphics::Mesh& GetMesh() const { return *_mesh; }
+	/// World space bounds of the block, from its map position and the altitudes of its cells
+	[[nodiscard]] const AxisAlignedBoundingBox& GetBoundingBox() const { return _boundingBox; }
+	/// Largest world space altitude difference between each level of detail and the full mesh
+	[[nodiscard]] const std::array<float, LodCount>& GetLodErrors() const { return _lodErrors; }
 	[[nodiscard]] const lnd::LNDCell* GetCells() const;
 	[[nodiscard]] glm::ivec2 GetBlockPosition() const;
 	[[nodiscard]] glm::vec4 GetMapPosition() const;
 
 private:
-	std::unique_ptr<lnd::LNDBlock> _block;
-	std::unique_ptr<graphics::Mesh> _mesh;
+	const lnd::LNDBlock* _block {nullptr};
+	AxisAlignedBoundingBox _boundingBox {};
+	std::array<float, LodCount> _lodErrors {};
 
-	const bgfx::Memory* buildVertexList(LandIsland& island);
+	/// Compute the bounding box and level of detail errors from the island grid
+	void UpdateBounds(const LandIsland& island);
 
 	friend LandIsland;
 };
+static_assert(LandBlock::GetLodVertexOffset(LandBlock::LodCount) == LandBlock::VertexCount);
 } // namespace openblack
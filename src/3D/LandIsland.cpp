@@ -14,12 +14,26 @@
 #include "Common/IStream.h"
 #include "Common/stb_image_write.h"
 #include "Game.h"
+#include "Graphics/IndexBuffer.h"
 
+#include <glm/glm.hpp>
 #include <spdlog/spdlog.h>
 
-#include <LNDFile.h>
+#include <LNDCookedFile.h>
+#include <LNDFileView.h>
+#include <ParallelFor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <limits>
 #include <stdexcept>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LAND_ISLAND_SSE2
+#endif
+
 using namespace openblack;
 using namespace openblack::graphics;
 
@@ -37,6 +51,8 @@ LandIsland::LandIsland()
 	_textureSmallBump = std::make_unique<Texture2D>("LandIslandSmallBump");
 	_textureSmallBump->Create(256, 256, 1, Format::R8, Wrapping::Repeat, smallbumpa, file->Size());
 	delete[] smallbumpa;
+
+	BuildGrid({});
 }
 
 LandIsland::~LandIsland() = default;
@@ -44,11 +60,11 @@ LandIsland::~LandIsland() = default;
 void LandIsland::LoadFromFile(const std::string& filename)
 {
 	spdlog::debug("Loading Land from file: {}", filename);
-	lnd::LNDFile lnd;
+	auto lnd = std::make_unique<lnd::LNDFileView>();
 
 	try
 	{
-		lnd.Open(filename);
+		lnd->Open(filename);
 	}
 	catch (std::runtime_error& err)
 	{
@@ -56,34 +72,107 @@ void LandIsland::LoadFromFile(const std::string& filename)
 		return;
 	}
 
-	std::memcpy(_blockIndexLookup.data(), lnd.GetHeader().lookUpTable, _blockIndexLookup.size() * sizeof(_blockIndexLookup[0]));
+	std::memcpy(_blockIndexLookup.data(), lnd->GetHeader().lookUpTable, _blockIndexLookup.size() * sizeof(_blockIndexLookup[0]));
 
-	auto& lndBlocks = lnd.GetBlocks();
+	auto lndBlocks = lnd->GetBlocks();
 	spdlog::debug("[LandIsland] loading {} blocks", lndBlocks.size());
+	if (lndBlocks.size() > MaxBlocks)
+	{
+		spdlog::error("Failed to load lnd file {}: {} blocks is more than the lookup table can address", filename,
+		              lndBlocks.size());
+		return;
+	}
 	_landBlocks.resize(lndBlocks.size());
 	for (size_t i = 0; i < _landBlocks.size(); i++)
 	{
-		_landBlocks[i]._block = std::make_unique<lnd::LNDBlock>(lndBlocks[i]);
+		_landBlocks[i]._block = &lndBlocks[i];
+	}
+	BuildGrid(lndBlocks);
+	for (auto& block : _landBlocks)
+	{
+		block.UpdateBounds(*this);
 	}
 
-	spdlog::debug("[LandIsland] loading {} countries", lnd.GetCountries().size());
-	_countries = lnd.GetCountries();
+	auto materials = lnd->GetMaterials();
 
-	auto materialCount = lnd.GetMaterials().size();
-	spdlog::debug("[LandIsland] loading {} textures", materialCount);
-	std::vector<uint16_t> rgba5TextureData;
-	rgba5TextureData.resize(lnd::LNDMaterial::width * lnd::LNDMaterial::height * lnd.GetMaterials().size());
-	for (size_t i = 0; i < lnd.GetMaterials().size(); i++)
+	// a cooked file next to the land file replaces everything built from it below, as long as it was cooked from it
+	std::unique_ptr<lnd::LNDCookedFile> cooked;
+	const auto cookedFilename = std::filesystem::path(filename).replace_extension(".lndc").string();
+	if (std::filesystem::exists(cookedFilename))
 	{
-		std::memcpy(&rgba5TextureData[lnd::LNDMaterial::width * lnd::LNDMaterial::height * i], lnd.GetMaterials()[i].texels,
-		            sizeof(lnd.GetMaterials()[i].texels));
+		cooked = std::make_unique<lnd::LNDCookedFile>();
+		try
+		{
+			cooked->Open(cookedFilename);
+			const auto& header = cooked->GetHeader();
+			if (!cooked->Matches(lnd->ComputeHash()) || header.blockCount != lndBlocks.size() ||
+			    header.materialCount != materials.size())
+			{
+				spdlog::warn("Ignoring cooked land file {}: it was not cooked from {}", cookedFilename, filename);
+				cooked.reset();
+			}
+		}
+		catch (std::runtime_error& err)
+		{
+			spdlog::warn("Failed to open cooked land file {}: {}", cookedFilename, err.what());
+			cooked.reset();
+		}
 	}
+	spdlog::debug("[LandIsland] {} cooked land file", cooked ? "using" : "no");
+	auto cookedSection = [&cooked](lnd::LNDCookedSection section) {
+		return cooked->GetSection<uint8_t>(section);
+	};
+
+	spdlog::debug("[LandIsland] loading {} countries", lnd->GetCountries().size());
+	_countries.assign(lnd->GetCountries().begin(), lnd->GetCountries().end());
+
+	// the terrain shader picks the materials of each cell corner from the country lookup, a row per country as
+	// addressed by the 4 bits of the cell properties
+	std::vector<uint8_t> countryLookup;
+	const uint8_t* countryLookupTexels;
+	if (cooked)
+	{
+		countryLookupTexels = cookedSection(lnd::LNDCookedSection::CountryLookup).data();
+	}
+	else
+	{
+		countryLookup.resize(lnd::TerrainLookupAltitudes * lnd::TerrainLookupCountries * 4);
+		lnd::BuildTerrainCountryLookup(lnd->GetCountries(), countryLookup.data());
+		countryLookupTexels = countryLookup.data();
+	}
+	_countryLookup = std::make_unique<Texture2D>("LandIslandCountryLookup");
+	_countryLookup->Create(lnd::TerrainLookupAltitudes, lnd::TerrainLookupCountries, 1, Format::RGBA8, Wrapping::ClampEdge,
+	                       countryLookupTexels, lnd::TerrainLookupAltitudes * lnd::TerrainLookupCountries * 4);
+
+	// the grid arrays keep their storage for the lifetime of the island and are uploaded in place
+	_altitudeMap = std::make_unique<Texture2D>("LandIslandAltitudeMap");
+	_altitudeMap->Create(GridSize, GridSize, 1, Format::R8, Wrapping::ClampEdge);
+	_cellPropertiesMap = std::make_unique<Texture2D>("LandIslandCellPropertiesMap");
+	_cellPropertiesMap->Create(GridSize, GridSize, 1, Format::R8, Wrapping::ClampEdge);
+	UploadGridMaps();
+
+	spdlog::debug("[LandIsland] loading {} textures", materials.size());
 	_materialArray = std::make_unique<Texture2D>("LandIslandMaterialArray");
-	_materialArray->Create(lnd::LNDMaterial::width, lnd::LNDMaterial::height, materialCount, Format::RGB5A1,
-	                       Wrapping::ClampEdge, rgba5TextureData.data(), rgba5TextureData.size() * sizeof(rgba5TextureData[0]));
+	if (cooked)
+	{
+		// the cooked texels of all materials are already one array
+		const auto texels = cookedSection(lnd::LNDCookedSection::Materials);
+		_materialArray->Create(lnd::LNDMaterial::width, lnd::LNDMaterial::height, static_cast<uint16_t>(materials.size()),
+		                       Format::RGB5A1, Wrapping::ClampEdge, texels.data(), texels.size());
+	}
+	else
+	{
+		// Materials are uploaded layer by layer straight from the mapping, skipping the type in front of the texels
+		_materialArray->Create(lnd::LNDMaterial::width, lnd::LNDMaterial::height, static_cast<uint16_t>(materials.size()),
+		                       Format::RGB5A1, Wrapping::ClampEdge);
+		for (size_t i = 0; i < materials.size(); i++)
+		{
+			_materialArray->UpdateLayer(static_cast<uint16_t>(i), materials[i].texels, sizeof(materials[i].texels));
+		}
+	}
 
 	// read noise map into Texture2D
-	std::memcpy(_noiseMap.data(), lnd.GetExtra().noise.texels, _noiseMap.size() * sizeof(_noiseMap[0]));
+	std::memcpy(_noiseMap.data(), lnd->GetExtra().noise.texels, _noiseMap.size() * sizeof(_noiseMap[0]));
 	_textureNoiseMap = std::make_unique<Texture2D>("LandIslandNoiseMap");
 	_textureNoiseMap->Create(lnd::LNDBumpMap::width, lnd::LNDBumpMap::height, 1, Format::R8, Wrapping::ClampEdge,
 	                         _noiseMap.data(), _noiseMap.size() * sizeof(_noiseMap[0]));
@@ -91,11 +180,72 @@ void LandIsland::LoadFromFile(const std::string& filename)
 	// read bump map into Texture2D
 	_textureBumpMap = std::make_unique<Texture2D>("LandIslandBumpMap");
 	_textureBumpMap->Create(lnd::LNDBumpMap::width, lnd::LNDBumpMap::height, 1, Format::R8, Wrapping::ClampEdge,
-	                        lnd.GetExtra().bump.texels, sizeof(lnd.GetExtra().bump.texels));
+	                        lnd->GetExtra().bump.texels, sizeof(lnd->GetExtra().bump.texels));
+
+	// Distant blocks are drawn with their materials blended once here rather than for every pixel. Materials are box
+	// filtered down to the size of a tile first, the atlas has no mip maps. Both are kept to bake edited blocks again.
+	constexpr size_t bakedTileTexels = BakedTileSize * BakedTileSize;
+	if (cooked)
+	{
+		const auto filtered = cooked->GetSection<float>(lnd::LNDCookedSection::FilteredMaterials);
+		_bakedMaterials.assign(filtered.begin(), filtered.end());
+		const auto tiles = cookedSection(lnd::LNDCookedSection::BakedTiles);
+		_bakedTiles.assign(tiles.begin(), tiles.end());
+	}
+	else
+	{
+		_bakedMaterials.resize(materials.size() * bakedTileTexels * 3);
+		ParallelFor(materials.size(), [this, &materials](size_t i) {
+			lnd::FilterTerrainMaterial(materials[i], &_bakedMaterials[i * bakedTileTexels * 3]);
+		});
+		_bakedTiles.resize(_landBlocks.size() * bakedTileTexels * 4);
+		ParallelFor(_landBlocks.size(), [this](size_t i) { BakeBlock(static_cast<uint16_t>(i)); });
+	}
+	_bakedAtlas = std::make_unique<Texture2D>("LandIslandBakedAtlas");
+	_bakedAtlas->Create(BakedAtlasTiles * BakedTileSize, BakedAtlasTiles * BakedTileSize, 1, Format::RGBA8,
+	                    Wrapping::ClampEdge);
+	for (uint16_t i = 0; i < _landBlocks.size(); i++)
+	{
+		UploadBakedTile(i);
+	}
+	_dirtyBakes.clear();
 
 	// build the meshes (we could move this elsewhere)
-	for (auto& block : _landBlocks) block.BuildMesh(*this);
+	const bgfx::Memory* indices;
+	if (cooked)
+	{
+		const auto cookedIndices = cookedSection(lnd::LNDCookedSection::Indices);
+		indices = bgfx::makeRef(cookedIndices.data(), static_cast<uint32_t>(cookedIndices.size()));
+	}
+	else
+	{
+		indices = bgfx::alloc(sizeof(uint16_t) * LandBlock::IndexCount);
+		LandBlock::BuildIndexList(reinterpret_cast<uint16_t*>(indices->data));
+	}
+	_indexBuffer = std::make_unique<IndexBuffer>("LandIndices", indices, IndexBuffer::Type::Uint16);
+
+	// all blocks share one vertex buffer so the renderer can draw many of them at once, bgfx memory is allocated and
+	// consumed on this thread, only the vertices are filled by the workers
+	const bgfx::Memory* vertices;
+	if (cooked)
+	{
+		const auto cookedVertices = cookedSection(lnd::LNDCookedSection::Vertices);
+		vertices = bgfx::makeRef(cookedVertices.data(), static_cast<uint32_t>(cookedVertices.size()));
+	}
+	else
+	{
+		vertices = bgfx::alloc(static_cast<uint32_t>(sizeof(LandVertex) * LandBlock::VertexCount * _landBlocks.size()));
+		auto* blockVertices = reinterpret_cast<LandVertex*>(vertices->data);
+		ParallelFor(_landBlocks.size(), [this, blockVertices](size_t i) {
+			_landBlocks[i].BuildVertexList(*this, static_cast<uint8_t>(i), blockVertices + i * LandBlock::VertexCount);
+		});
+	}
+	_vertexBuffer = std::make_unique<VertexBuffer>("LandVertices", vertices, LandBlock::GetVertexDecl(), true);
+	_dirtyBlocks.clear();
 	bgfx::frame();
+
+	_lnd = std::move(lnd);
+	_cooked = std::move(cooked);
 }
 
 float LandIsland::GetHeightAt(glm::vec2 vec) const
@@ -103,7 +253,307 @@ float LandIsland::GetHeightAt(glm::vec2 vec) const
 	return GetCell(vec * 0.1f).altitude * LandIsland::HeightUnit;
 }
 
-uint8_t LandIsland::GetNoise(int x, int y)
+float LandIsland::SampleHeight(glm::vec2 position, glm::vec3& normal) const
+{
+	// multiply rather than divide to round exactly like SampleHeights
+	const glm::vec2 cell = glm::clamp(position * (1.0f / CellSize), glm::vec2(0.0f), glm::vec2(GridSize - 1));
+	const glm::vec2 corner = glm::min(glm::floor(cell), glm::vec2(GridSize - 2));
+	const glm::vec2 fraction = cell - corner;
+
+	const auto index = GridIndex(static_cast<uint16_t>(corner.x), static_cast<uint16_t>(corner.y));
+	const float topLeft = _altitudes[index];
+	const float topRight = _altitudes[index + GridSize];
+	const float bottomLeft = _altitudes[index + 1];
+	const float bottomRight = _altitudes[index + GridSize + 1];
+
+	// slope of the triangle along x and z in altitude units per cell, and its altitude at the top left corner
+	float slopeX;
+	float slopeZ;
+	float origin = topLeft;
+	if (!_cellProperties[index].split)
+	{
+		// diagonal from the top left to the bottom right corner
+		if (fraction.x >= fraction.y)
+		{
+			slopeX = topRight - topLeft;
+			slopeZ = bottomRight - topRight;
+		}
+		else
+		{
+			slopeX = bottomRight - bottomLeft;
+			slopeZ = bottomLeft - topLeft;
+		}
+	}
+	else
+	{
+		// diagonal from the top right to the bottom left corner
+		if (fraction.x + fraction.y <= 1.0f)
+		{
+			slopeX = topRight - topLeft;
+			slopeZ = bottomLeft - topLeft;
+		}
+		else
+		{
+			slopeX = bottomRight - bottomLeft;
+			slopeZ = bottomRight - topRight;
+			origin = bottomRight - slopeX - slopeZ;
+		}
+	}
+
+	normal = glm::normalize(glm::vec3(-slopeX * HeightUnit / CellSize, 1.0f, -slopeZ * HeightUnit / CellSize));
+	return (origin + slopeX * fraction.x + slopeZ * fraction.y) * HeightUnit;
+}
+
+void LandIsland::SampleHeightsScalar(const std::vector<glm::vec2>& positions, std::vector<float>& heights,
+                                     std::vector<glm::vec3>& normals) const
+{
+	heights.resize(positions.size());
+	normals.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		heights[i] = SampleHeight(positions[i], normals[i]);
+	}
+}
+
+void LandIsland::SampleHeights(const std::vector<glm::vec2>& positions, std::vector<float>& heights,
+                               std::vector<glm::vec3>& normals) const
+{
+	heights.resize(positions.size());
+	normals.resize(positions.size());
+
+	size_t i = 0;
+#ifdef LAND_ISLAND_SSE2
+	// the same steps as SampleHeight, with the choice of triangle turned into masks
+	auto select = [](__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 inverseCellSize = _mm_set1_ps(1.0f / CellSize);
+	const __m128 gridExtent = _mm_set1_ps(GridSize - 1);
+	const __m128 lastCorner = _mm_set1_ps(GridSize - 2);
+	const __m128 heightUnit = _mm_set1_ps(HeightUnit);
+	const __m128 normalScale = _mm_set1_ps(-HeightUnit / CellSize);
+
+	alignas(16) int32_t indices[4];
+	alignas(16) float topLeft[4];
+	alignas(16) float topRight[4];
+	alignas(16) float bottomLeft[4];
+	alignas(16) float bottomRight[4];
+	alignas(16) uint32_t split[4];
+	alignas(16) float normalX[4];
+	alignas(16) float normalY[4];
+	alignas(16) float normalZ[4];
+	for (; i + 4 <= positions.size(); i += 4)
+	{
+		const __m128 xz01 = _mm_loadu_ps(&positions[i].x);
+		const __m128 xz23 = _mm_loadu_ps(&positions[i + 2].x);
+		const __m128 positionX = _mm_mul_ps(_mm_shuffle_ps(xz01, xz23, _MM_SHUFFLE(2, 0, 2, 0)), inverseCellSize);
+		const __m128 positionZ = _mm_mul_ps(_mm_shuffle_ps(xz01, xz23, _MM_SHUFFLE(3, 1, 3, 1)), inverseCellSize);
+		const __m128 x = _mm_min_ps(_mm_max_ps(positionX, zero), gridExtent);
+		const __m128 z = _mm_min_ps(_mm_max_ps(positionZ, zero), gridExtent);
+		// truncation is the floor for positive values
+		const __m128 cornerX = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(x)), lastCorner);
+		const __m128 cornerZ = _mm_min_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(z)), lastCorner);
+		const __m128 fractionX = _mm_sub_ps(x, cornerX);
+		const __m128 fractionZ = _mm_sub_ps(z, cornerZ);
+
+		// SSE2 has no gather, the corners are read one position at a time
+		const __m128 index = _mm_add_ps(_mm_mul_ps(cornerX, _mm_set1_ps(GridSize)), cornerZ);
+		_mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_cvttps_epi32(index));
+		for (int j = 0; j < 4; j++)
+		{
+			const auto cell = static_cast<uint32_t>(indices[j]);
+			topLeft[j] = _altitudes[cell];
+			topRight[j] = _altitudes[cell + GridSize];
+			bottomLeft[j] = _altitudes[cell + 1];
+			bottomRight[j] = _altitudes[cell + GridSize + 1];
+			split[j] = _cellProperties[cell].split ? 0xFFFFFFFFU : 0U;
+		}
+		const __m128 h00 = _mm_load_ps(topLeft);
+		const __m128 h10 = _mm_load_ps(topRight);
+		const __m128 h01 = _mm_load_ps(bottomLeft);
+		const __m128 h11 = _mm_load_ps(bottomRight);
+		const __m128 isSplit = _mm_castsi128_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(split)));
+
+		// whether the triangle has the top edge and the left edge of the cell, and so the top left corner
+		const __m128 splitTopLeft = _mm_cmple_ps(_mm_add_ps(fractionX, fractionZ), one);
+		const __m128 topRightHalf = _mm_cmpge_ps(fractionX, fractionZ);
+		const __m128 hasTop = select(isSplit, splitTopLeft, topRightHalf);
+		const __m128 bottomLeftHalf = _mm_cmplt_ps(fractionX, fractionZ);
+		const __m128 hasLeft = select(isSplit, splitTopLeft, bottomLeftHalf);
+
+		const __m128 slopeX = select(hasTop, _mm_sub_ps(h10, h00), _mm_sub_ps(h11, h01));
+		const __m128 slopeZ = select(hasLeft, _mm_sub_ps(h01, h00), _mm_sub_ps(h11, h10));
+		const __m128 origin = select(_mm_or_ps(hasTop, hasLeft), h00, _mm_sub_ps(_mm_sub_ps(h11, slopeX), slopeZ));
+		const __m128 height = _mm_add_ps(origin, _mm_add_ps(_mm_mul_ps(slopeX, fractionX), _mm_mul_ps(slopeZ, fractionZ)));
+		_mm_storeu_ps(&heights[i], _mm_mul_ps(height, heightUnit));
+
+		const __m128 nx = _mm_mul_ps(slopeX, normalScale);
+		const __m128 nz = _mm_mul_ps(slopeZ, normalScale);
+		const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), one), _mm_mul_ps(nz, nz));
+		const __m128 inverseLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+		_mm_store_ps(normalX, _mm_mul_ps(nx, inverseLength));
+		_mm_store_ps(normalY, inverseLength);
+		_mm_store_ps(normalZ, _mm_mul_ps(nz, inverseLength));
+		for (int j = 0; j < 4; j++)
+		{
+			normals[i + j] = glm::vec3(normalX[j], normalY[j], normalZ[j]);
+		}
+	}
+#endif
+
+	for (; i < positions.size(); i++)
+	{
+		heights[i] = SampleHeight(positions[i], normals[i]);
+	}
+}
+
+bool LandIsland::RayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const
+{
+	// work in grid units, one per cell and altitude unit, which leaves the distance along the ray unchanged
+	const glm::vec3 scale(1.0f / CellSize, 1.0f / HeightUnit, 1.0f / CellSize);
+	const glm::vec3 rayOrigin = origin * scale;
+	const glm::vec3 rayDirection = direction * scale;
+	glm::vec3 inverseDirection;
+	for (glm::length_t i = 0; i < 3; i++)
+	{
+		// avoid infinities so the slabs of axis parallel rays never produce NaN
+		const float component = std::abs(rayDirection[i]) > 1e-20f ? rayDirection[i] : std::copysign(1e-20f, rayDirection[i]);
+		inverseDirection[i] = 1.0f / component;
+	}
+
+	float nearest = maxDistance;
+	bool hit = false;
+	// distance at which the ray enters the bounds of a node, or infinity when it misses them before nearest
+	auto enter = [&](uint8_t level, uint16_t x, uint16_t z) -> float {
+		const auto side = static_cast<uint16_t>((GridSize - 1) >> level);
+		const auto& bounds = _altitudeBounds[level][x * side + z];
+		const glm::vec3 minima(x << level, bounds.x, z << level);
+		const glm::vec3 maxima((x + 1) << level, bounds.y, (z + 1) << level);
+		const glm::vec3 t0 = (minima - rayOrigin) * inverseDirection;
+		const glm::vec3 t1 = (maxima - rayOrigin) * inverseDirection;
+		const glm::vec3 tNear = glm::min(t0, t1);
+		const glm::vec3 tFar = glm::max(t0, t1);
+		const float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		const float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, nearest));
+		return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+	};
+
+	// Möller-Trumbore, double sided
+	auto intersectTriangle = [&](const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2) {
+		const glm::vec3 edge1 = v1 - v0;
+		const glm::vec3 edge2 = v2 - v0;
+		const glm::vec3 p = glm::cross(rayDirection, edge2);
+		const float determinant = glm::dot(edge1, p);
+		if (std::abs(determinant) < 1e-12f)
+			return;
+		const float inverseDeterminant = 1.0f / determinant;
+		const glm::vec3 s = rayOrigin - v0;
+		const float u = glm::dot(s, p) * inverseDeterminant;
+		if (u < 0.0f || u > 1.0f)
+			return;
+		const glm::vec3 q = glm::cross(s, edge1);
+		const float v = glm::dot(rayDirection, q) * inverseDeterminant;
+		if (v < 0.0f || u + v > 1.0f)
+			return;
+		const float t = glm::dot(edge2, q) * inverseDeterminant;
+		if (t >= 0.0f && t <= nearest)
+		{
+			nearest = t;
+			distance = t;
+			hit = true;
+		}
+	};
+
+	struct Node
+	{
+		uint8_t level;
+		uint16_t x;
+		uint16_t z;
+		float entry;
+	};
+	// every node visited replaces itself with at most 4 children
+	std::array<Node, AltitudeBoundsLevels * 3 + 1> stack;
+	size_t top = 0;
+
+	const float rootEntry = enter(AltitudeBoundsLevels - 1, 0, 0);
+	if (std::isinf(rootEntry))
+		return false;
+	stack[top++] = {AltitudeBoundsLevels - 1, 0, 0, rootEntry};
+
+	while (top > 0)
+	{
+		const Node node = stack[--top];
+		if (node.entry > nearest)
+			continue;
+
+		if (node.level == 0)
+		{
+			// the same triangles as the full level of detail mesh, see LandBlock::BuildVertexList
+			auto vertex = [this](uint16_t x, uint16_t z) {
+				return glm::vec3(x, _altitudes[GridIndex(x, z)], z);
+			};
+			const auto topLeft = vertex(node.x, node.z);
+			const auto topRight = vertex(node.x + 1, node.z);
+			const auto bottomLeft = vertex(node.x, node.z + 1);
+			const auto bottomRight = vertex(node.x + 1, node.z + 1);
+			if (!_cellProperties[GridIndex(node.x, node.z)].split)
+			{
+				intersectTriangle(topRight, bottomRight, topLeft);
+				intersectTriangle(bottomRight, bottomLeft, topLeft);
+			}
+			else
+			{
+				intersectTriangle(topLeft, topRight, bottomLeft);
+				intersectTriangle(topRight, bottomRight, bottomLeft);
+			}
+			continue;
+		}
+
+		// push the children furthest first so the nearest is visited next
+		std::array<Node, 4> children;
+		size_t childCount = 0;
+		for (uint16_t i = 0; i < 4; i++)
+		{
+			const auto level = static_cast<uint8_t>(node.level - 1);
+			const auto x = static_cast<uint16_t>(node.x * 2 + i / 2);
+			const auto z = static_cast<uint16_t>(node.z * 2 + i % 2);
+			const float entry = enter(level, x, z);
+			if (!std::isinf(entry))
+			{
+				children[childCount++] = {level, x, z, entry};
+			}
+		}
+		std::sort(children.begin(), children.begin() + childCount,
+		          [](const Node& a, const Node& b) { return a.entry > b.entry; });
+		for (size_t i = 0; i < childCount; i++)
+		{
+			stack[top++] = children[i];
+		}
+	}
+
+	return hit;
+}
+
+void LandIsland::RayCast(const std::vector<glm::vec3>& origins, const std::vector<glm::vec3>& directions, float maxDistance,
+                         std::vector<float>& distances) const
+{
+	assert(origins.size() == directions.size());
+	distances.resize(origins.size());
+
+	// enough rays per task for the threads to be worth starting
+	constexpr size_t raysPerTask = 256;
+	ParallelFor((origins.size() + raysPerTask - 1) / raysPerTask, [&](size_t task) {
+		const auto end = std::min(origins.size(), (task + 1) * raysPerTask);
+		for (auto i = task * raysPerTask; i < end; i++)
+		{
+			float distance;
+			distances[i] =
+			    RayCast(origins[i], directions[i], maxDistance, distance) ? distance : std::numeric_limits<float>::infinity();
+		}
+	});
+}
+
+uint8_t LandIsland::GetNoise(int x, int y) const
 {
 	return _noiseMap[(y & 0xFF) + 256 * (x & 0xFF)];
 }
@@ -121,33 +571,293 @@ const LandBlock* LandIsland::GetBlock(const glm::u8vec2& coordinates) const
 	return &_landBlocks[blockIndex - 1];
 }
 
-constexpr lnd::LNDCell EmptyCell() noexcept
+void LandIsland::SelectLods(const glm::vec3& eye, float errorScale, std::vector<LandBlockLod>& lods) const
+{
+	lods.resize(_landBlocks.size());
+	for (size_t i = 0; i < _landBlocks.size(); i++)
+	{
+		const auto& box = _landBlocks[i].GetBoundingBox();
+		const float distance = glm::length(glm::clamp(eye, box.minima, box.maxima) - eye);
+		const auto& errors = _landBlocks[i].GetLodErrors();
+
+		uint8_t level = LandBlock::LodCount - 1;
+		while (level > 0 && errors[level] * errorScale > distance)
+		{
+			level--;
+		}
+		lods[i] = {level, 0};
+	}
+
+	auto neighbour = [this](const glm::ivec2& position, int dx, int dz) -> int {
+		const int x = position.x + dx;
+		const int z = position.y + dz;
+		if (x < 0 || x >= 32 || z < 0 || z >= 32)
+			return -1;
+		return static_cast<int>(_blockIndexLookup[x * 32 + z]) - 1;
+	};
+	constexpr std::array<std::array<int, 2>, 4> directions = {{{-1, 0}, {1, 0}, {0, -1}, {0, 1}}};
+
+	// levels only ever go down so this terminates
+	for (bool changed = true; changed;)
+	{
+		changed = false;
+		for (size_t i = 0; i < _landBlocks.size(); i++)
+		{
+			const auto position = _landBlocks[i].GetBlockPosition();
+			for (const auto& [dx, dz] : directions)
+			{
+				const int n = neighbour(position, dx, dz);
+				if (n >= 0 && lods[i].level > lods[n].level + 1)
+				{
+					lods[i].level = lods[n].level + 1;
+					changed = true;
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < _landBlocks.size(); i++)
+	{
+		const auto position = _landBlocks[i].GetBlockPosition();
+		for (size_t d = 0; d < directions.size(); d++)
+		{
+			const int n = neighbour(position, directions[d][0], directions[d][1]);
+			if (n >= 0 && lods[n].level == lods[i].level + 1)
+			{
+				lods[i].coarserNeighbours |= 1U << d;
+			}
+		}
+	}
+}
+
+LandCell LandIsland::GetCell(const glm::u16vec2& coordinates) const
+{
+	if (coordinates.x >= GridSize || coordinates.y >= GridSize)
+	{
+		lnd::LNDCell::Properties properties {};
+		properties.fullWater = true;
+		return {0, properties, 0};
+	}
+
+	const auto index = GridIndex(coordinates.x, coordinates.y);
+	return {_altitudes[index], _cellProperties[index], _luminosities[index]};
+}
+
+void LandIsland::SetAltitude(const glm::u16vec2& coordinates, uint8_t altitude)
 {
-	lnd::LNDCell cell {};
-	cell.properties.fullWater = true;
-	return cell;
+	if (coordinates.x >= GridSize || coordinates.y >= GridSize)
+		return;
+
+	_altitudes[GridIndex(coordinates.x, coordinates.y)] = altitude;
+	UpdateAltitudeBounds(coordinates);
+	MarkDirty(coordinates, _dirtyBlocks);
+	_gridMapsDirty = true;
 }
 
-constexpr lnd::LNDCell s_EmptyCell = EmptyCell();
+void LandIsland::SetCountry(const glm::u16vec2& coordinates, uint8_t country)
+{
+	if (coordinates.x >= GridSize || coordinates.y >= GridSize || country >= _countries.size())
+		return;
+
+	// materials are looked up by the terrain shader, the meshes stay as they are and only the baked materials change
+	_cellProperties[GridIndex(coordinates.x, coordinates.y)].country = country;
+	MarkDirty(coordinates, _dirtyBakes);
+	_gridMapsDirty = true;
+}
 
-const lnd::LNDCell& LandIsland::GetCell(const glm::u16vec2& coordinates) const
+void LandIsland::AdjustAltitude(const glm::u16vec2& from, const glm::u16vec2& to, int delta)
 {
-	if (coordinates.x > 511 || coordinates.y > 511)
+	const auto last = glm::min(to, glm::u16vec2(GridSize - 1));
+	for (uint16_t x = from.x; x <= last.x; x++)
 	{
-		return s_EmptyCell;
+		for (uint16_t z = from.y; z <= last.y; z++)
+		{
+			auto& altitude = _altitudes[GridIndex(x, z)];
+			altitude = static_cast<uint8_t>(glm::clamp(altitude + delta, 0, 0xFF));
+			UpdateAltitudeBounds({x, z});
+			MarkDirty({x, z}, _dirtyBlocks);
+		}
 	}
+	_gridMapsDirty = true;
+}
 
-	const uint16_t lookupIndex = ((coordinates.x & ~0xFU) << 1U) | (coordinates.y >> 4U);
-	const uint16_t cellIndex = (coordinates.x & 0xFU) * 0x11u + (coordinates.y & 0xFU);
+void LandIsland::MarkDirty(const glm::u16vec2& coordinates, std::vector<uint16_t>& blocks)
+{
+	const auto blockX = coordinates.x / 16;
+	const auto blockZ = coordinates.y / 16;
+	// a cell on the first row or column of a block is also the far corner of the block before it
+	const auto firstX = coordinates.x % 16 == 0 ? std::max(blockX - 1, 0) : blockX;
+	const auto firstZ = coordinates.y % 16 == 0 ? std::max(blockZ - 1, 0) : blockZ;
+	for (int x = firstX; x <= std::min(blockX, 31); x++)
+	{
+		for (int z = firstZ; z <= std::min(blockZ, 31); z++)
+		{
+			const uint8_t blockIndex = _blockIndexLookup[x * 32 + z];
+			if (blockIndex != 0)
+			{
+				blocks.push_back(blockIndex - 1);
+			}
+		}
+	}
+}
 
-	const uint8_t blockIndex = _blockIndexLookup[lookupIndex];
+void LandIsland::UploadGridMaps()
+{
+	_altitudeMap->UpdateLayer(0, _altitudes.data(), _altitudes.size() * sizeof(_altitudes[0]));
+	_cellPropertiesMap->UpdateLayer(0, _cellProperties.data(), _cellProperties.size() * sizeof(_cellProperties[0]));
+	_gridMapsDirty = false;
+}
 
-	if (blockIndex == 0)
+void LandIsland::RebuildDirtyBlocks()
+{
+	if (_vertexBuffer == nullptr)
+		return;
+
+	if (_gridMapsDirty)
+	{
+		UploadGridMaps();
+	}
+
+	if (_dirtyBlocks.empty() && _dirtyBakes.empty())
+		return;
+
+	std::sort(_dirtyBlocks.begin(), _dirtyBlocks.end());
+	_dirtyBlocks.erase(std::unique(_dirtyBlocks.begin(), _dirtyBlocks.end()), _dirtyBlocks.end());
+
+	// same split as LoadFromFile, bgfx memory is allocated and consumed on this thread
+	std::vector<const bgfx::Memory*> vertices(_dirtyBlocks.size());
+	for (auto& memory : vertices)
+	{
+		memory = bgfx::alloc(sizeof(LandVertex) * LandBlock::VertexCount);
+	}
+	ParallelFor(_dirtyBlocks.size(), [this, &vertices](size_t i) {
+		auto& block = _landBlocks[_dirtyBlocks[i]];
+		block.UpdateBounds(*this);
+		block.BuildVertexList(*this, static_cast<uint8_t>(_dirtyBlocks[i]), reinterpret_cast<LandVertex*>(vertices[i]->data));
+	});
+	for (size_t i = 0; i < _dirtyBlocks.size(); i++)
+	{
+		_vertexBuffer->Update(_dirtyBlocks[i] * LandBlock::VertexCount, vertices[i]);
+	}
+
+	// materials depend on the altitudes, every rebuilt block is baked again too
+	_dirtyBakes.insert(_dirtyBakes.end(), _dirtyBlocks.begin(), _dirtyBlocks.end());
+	std::sort(_dirtyBakes.begin(), _dirtyBakes.end());
+	_dirtyBakes.erase(std::unique(_dirtyBakes.begin(), _dirtyBakes.end()), _dirtyBakes.end());
+	ParallelFor(_dirtyBakes.size(), [this](size_t i) { BakeBlock(_dirtyBakes[i]); });
+	for (auto blockIndex : _dirtyBakes)
+	{
+		UploadBakedTile(blockIndex);
+	}
+
+	_dirtyBlocks.clear();
+	_dirtyBakes.clear();
+}
+
+void LandIsland::BakeBlock(uint16_t blockIndex)
+{
+	constexpr size_t tileTexels = BakedTileSize * BakedTileSize;
+	const lnd::LNDTerrainGrid grid {_altitudes.data(), _cellProperties.data(), _luminosities.data()};
+	const auto position = _landBlocks[blockIndex].GetBlockPosition();
+	lnd::BakeTerrainBlock(grid, Span<lnd::LNDCountry>(_countries.data(), _countries.size()), _noiseMap.data(),
+	                      _bakedMaterials.data(), _bakedMaterials.size() / (tileTexels * 3), position.x, position.y,
+	                      &_bakedTiles[blockIndex * tileTexels * 4]);
+}
+
+void LandIsland::UploadBakedTile(uint16_t blockIndex)
+{
+	constexpr size_t tileBytes = BakedTileSize * BakedTileSize * 4;
+	_bakedAtlas->UpdateRegion(0, static_cast<uint16_t>(blockIndex % BakedAtlasTiles * BakedTileSize),
+	                          static_cast<uint16_t>(blockIndex / BakedAtlasTiles * BakedTileSize), BakedTileSize,
+	                          BakedTileSize, &_bakedTiles[blockIndex * tileBytes], tileBytes);
+}
+
+void LandIsland::BuildGrid(Span<lnd::LNDBlock> blocks)
+{
+	_altitudes.resize(GridSize * GridSize);
+	_cellProperties.resize(GridSize * GridSize);
+	_luminosities.resize(GridSize * GridSize);
+	lnd::BuildTerrainGrid(blocks, _blockIndexLookup.data(), _altitudes.data(), _cellProperties.data(), _luminosities.data());
+
+	BuildAltitudeBounds();
+}
+
+void LandIsland::BuildAltitudeBounds()
+{
+	constexpr uint16_t cells = GridSize - 1;
+	static_assert(cells >> (AltitudeBoundsLevels - 1) == 1);
+
+	auto& cellBounds = _altitudeBounds[0];
+	cellBounds.resize(cells * cells);
+	for (uint16_t x = 0; x < cells; x++)
+	{
+		for (uint16_t z = 0; z < cells; z++)
+		{
+			const auto index = GridIndex(x, z);
+			const auto [lowest, highest] = std::minmax({_altitudes[index], _altitudes[index + 1], _altitudes[index + GridSize],
+			                                             _altitudes[index + GridSize + 1]});
+			cellBounds[x * cells + z] = {lowest, highest};
+		}
+	}
+
+	for (uint8_t level = 1; level < AltitudeBoundsLevels; level++)
 	{
-		return s_EmptyCell;
+		const uint16_t side = cells >> level;
+		const auto& children = _altitudeBounds[level - 1];
+		auto& bounds = _altitudeBounds[level];
+		bounds.resize(side * side);
+		for (uint16_t x = 0; x < side; x++)
+		{
+			for (uint16_t z = 0; z < side; z++)
+			{
+				const auto child = (x * 2) * (side * 2) + z * 2;
+				const auto& a = children[child];
+				const auto& b = children[child + 1];
+				const auto& c = children[child + side * 2];
+				const auto& d = children[child + side * 2 + 1];
+				bounds[x * side + z] = {std::min({a.x, b.x, c.x, d.x}), std::max({a.y, b.y, c.y, d.y})};
+			}
+		}
+	}
+}
+
+void LandIsland::UpdateAltitudeBounds(const glm::u16vec2& coordinates)
+{
+	constexpr uint16_t cells = GridSize - 1;
+
+	// the vertex is a corner of up to 4 cells
+	const uint16_t firstX = coordinates.x > 0 ? coordinates.x - 1 : 0;
+	const uint16_t firstZ = coordinates.y > 0 ? coordinates.y - 1 : 0;
+	const uint16_t lastX = std::min<uint16_t>(coordinates.x, cells - 1);
+	const uint16_t lastZ = std::min<uint16_t>(coordinates.y, cells - 1);
+	for (uint16_t x = firstX; x <= lastX; x++)
+	{
+		for (uint16_t z = firstZ; z <= lastZ; z++)
+		{
+			const auto index = GridIndex(x, z);
+			const auto [lowest, highest] = std::minmax({_altitudes[index], _altitudes[index + 1], _altitudes[index + GridSize],
+			                                             _altitudes[index + GridSize + 1]});
+			_altitudeBounds[0][x * cells + z] = {lowest, highest};
+		}
+	}
+
+	for (uint8_t level = 1; level < AltitudeBoundsLevels; level++)
+	{
+		const uint16_t side = cells >> level;
+		const auto& children = _altitudeBounds[level - 1];
+		for (uint16_t x = firstX >> level; x <= lastX >> level; x++)
+		{
+			for (uint16_t z = firstZ >> level; z <= lastZ >> level; z++)
+			{
+				const auto child = (x * 2) * (side * 2) + z * 2;
+				const auto& a = children[child];
+				const auto& b = children[child + 1];
+				const auto& c = children[child + side * 2];
+				const auto& d = children[child + side * 2 + 1];
+				_altitudeBounds[level][x * side + z] = {std::min({a.x, b.x, c.x, d.x}), std::max({a.y, b.y, c.y, d.y})};
+			}
+		}
 	}
-	assert(_landBlocks.size() >= blockIndex);
-	return _landBlocks[blockIndex - 1].GetCells()[cellIndex];
 }
 
 void LandIsland::DumpTextures()
@@ -166,25 +876,12 @@ void LandIsland::DumpMaps()
 
 	memset(data, 0x00, 32 * 32 * cellsize * cellsize);
 
-	for (unsigned int b = 0; b < _landBlocks.size(); b++)
+	const int lineStride = 32 * cellsize;
+	for (uint16_t x = 0; x < lineStride; x++)
 	{
-		LandBlock& block = _landBlocks[b];
-
-		int mapx = block.GetBlockPosition().x;
-		int mapz = block.GetBlockPosition().y;
-		int lineStride = 32 * cellsize;
-
-		for (int x = 0; x < cellsize; x++)
+		for (uint16_t y = 0; y < lineStride; y++)
 		{
-			for (int y = 0; y < cellsize; y++)
-			{
-				auto cell = block.GetCells()[y * 17 + x];
-
-				int cellX = (mapx * cellsize) + x;
-				int cellY = (mapz * cellsize) + y;
-
-				data[(cellY * lineStride) + cellX] = cell.altitude;
-			}
+			data[(y * lineStride) + x] = _altitudes[GridIndex(x, y)];
 		}
 	}
 
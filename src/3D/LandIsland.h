@@ -9,10 +9,16 @@
 
 #pragma once
 
-#include "Graphics/Mesh.h"
+#include "Graphics/IndexBuffer.h"
 #include "Graphics/Texture2D.h"
+#include "Graphics/VertexBuffer.h"
 #include "LandBlock.h"
 
+#include <LNDFile.h>
+#include <LNDTerrain.h>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
 #include <array>
 #include <memory>
 #include <string>
@@ -23,47 +29,162 @@ namespace openblack
 
 namespace lnd
 {
-struct LNDCountry;
-}
+class LNDCookedFile;
+class LNDFileView;
+} // namespace lnd
+
+/// Value of one cell of the island grid
+struct LandCell
+{
+	uint8_t altitude;
+	lnd::LNDCell::Properties properties;
+	uint8_t luminosity;
+};
 
 class LandIsland
 {
 public:
 	static const float HeightUnit;
 	static const float CellSize;
+	/// Cells per side of the island grid: 32 blocks of 16 cells plus a row of padding so the far corners of the last
+	/// blocks can be read without bounds checks
+	static constexpr uint16_t GridSize = lnd::TerrainGridSize;
+	/// The block lookup table is 8 bits with 0 meaning no block
+	static constexpr uint16_t MaxBlocks = 255;
+	/// Consecutive blocks whose vertices can all be reached with 16 bit indices from the first vertex of the batch
+	static constexpr uint16_t BlocksPerBatch = 0x10000 / LandBlock::VertexCount;
+
+	/// Levels of the min/max altitude pyramid, from one node per cell up to a single node for the whole grid
+	static constexpr uint8_t AltitudeBoundsLevels = 10;
+
+	/// Texels per side of the baked materials of a block, 4 per cell
+	static constexpr uint16_t BakedTileSize = lnd::TerrainBakedTileSize;
+	/// Tiles per side of the baked atlas, one tile per block in the order of GetBlocks
+	static constexpr uint16_t BakedAtlasTiles = 16;
+	static_assert(BakedAtlasTiles * BakedAtlasTiles >= MaxBlocks);
+
+	/// Index of a cell in the grid arrays, x major like the cells of a block
+	[[nodiscard]] static constexpr uint32_t GridIndex(uint16_t x, uint16_t y) { return lnd::TerrainGridIndex(x, y); }
 
 	LandIsland();
 	~LandIsland();
 
+	/// Load an island from an LND. When a cooked file of the same name with the .lndc extension was cooked from this
+	/// very LND, see lndtool cook, the meshes and baked textures are taken from it instead of being built.
 	void LoadFromFile(const std::string& filename);
 
 	[[nodiscard]] float GetHeightAt(glm::vec2) const;
+	/// Height of the terrain at a position, interpolated over the triangle of the cell it falls in like the full level
+	/// of detail mesh, along with the normal of that triangle. Positions off the grid are clamped to its edge.
+	[[nodiscard]] float SampleHeight(glm::vec2 position, glm::vec3& normal) const;
+	/// SampleHeight for many positions at once, 4 at a time with SSE2 where available
+	void SampleHeights(const std::vector<glm::vec2>& positions, std::vector<float>& heights,
+	                   std::vector<glm::vec3>& normals) const;
+	/// SampleHeights one position at a time, the reference the SIMD version is measured and checked against
+	void SampleHeightsScalar(const std::vector<glm::vec2>& positions, std::vector<float>& heights,
+	                         std::vector<glm::vec3>& normals) const;
+	/// Nearest intersection of a ray with the triangles of the full level of detail terrain. On a hit, distance is set to
+	/// how far along the ray it is in multiples of the length of direction, which is at most maxDistance.
+	[[nodiscard]] bool RayCast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float& distance) const;
+	/// RayCast many rays at once, spread over worker threads. Rays which miss get an infinite distance.
+	void RayCast(const std::vector<glm::vec3>& origins, const std::vector<glm::vec3>& directions, float maxDistance,
+	             std::vector<float>& distances) const;
 	[[nodiscard]] const LandBlock* GetBlock(const glm::u8vec2& coordinates) const;
-	[[nodiscard]] const lnd::LNDCell& GetCell(const glm::u16vec2& coordinates) const;
+	/// Choose the level of detail of every block, in the order of GetBlocks. The coarsest level whose error, scaled by
+	/// errorScale and divided by the distance to the eye, stays under 1 is used. Neighbours are then refined until they
+	/// differ by at most one level so the vertex shader can stitch them.
+	void SelectLods(const glm::vec3& eye, float errorScale, std::vector<LandBlockLod>& lods) const;
+	[[nodiscard]] LandCell GetCell(const glm::u16vec2& coordinates) const;
+	[[nodiscard]] const uint8_t* GetAltitudes() const { return _altitudes.data(); }
+	[[nodiscard]] const lnd::LNDCell::Properties* GetCellProperties() const { return _cellProperties.data(); }
+	[[nodiscard]] const uint8_t* GetLuminosities() const { return _luminosities.data(); }
+
+	// Editing, changes reach the renderer on the next RebuildDirtyBlocks
+	void SetAltitude(const glm::u16vec2& coordinates, uint8_t altitude);
+	void SetCountry(const glm::u16vec2& coordinates, uint8_t country);
+	/// Raise or lower the altitude of every cell between from and to inclusive, clamped to the range of a byte
+	void AdjustAltitude(const glm::u16vec2& from, const glm::u16vec2& to, int delta);
+	/// Rebuild and upload the vertices and baked materials of the blocks touched by edits since the last call, and the
+	/// grid maps
+	void RebuildDirtyBlocks();
 
 	// Debug
 	void DumpTextures();
 	void DumpMaps();
 
 private:
+	/// Mapped land file, blocks point into it for the lifetime of the island
+	std::unique_ptr<lnd::LNDFileView> _lnd;
+	/// Mapped cooked file when one matched the land file, the GPU buffers may still be reading from it
+	std::unique_ptr<lnd::LNDCookedFile> _cooked;
 	std::array<uint8_t, 1024> _blockIndexLookup;
 	std::vector<LandBlock> _landBlocks;
 	std::vector<lnd::LNDCountry> _countries;
 
+	/// Cells of every block copied once at load into GridSize * GridSize arrays, cells without a block are deep water
+	std::vector<uint8_t> _altitudes;
+	std::vector<lnd::LNDCell::Properties> _cellProperties;
+	std::vector<uint8_t> _luminosities;
+
+	/// Lowest and highest altitude under every node of each level of the pyramid, level 0 has a node per cell of the
+	/// grid, the quad between 4 of its vertices, and every level above it halves the nodes per side
+	std::array<std::vector<glm::u8vec2>, AltitudeBoundsLevels> _altitudeBounds;
+
+	/// Blocks whose cells were edited, may contain duplicates
+	std::vector<uint16_t> _dirtyBlocks;
+	/// Blocks whose materials changed but not their vertices, may contain duplicates
+	std::vector<uint16_t> _dirtyBakes;
+
+	/// Every material box filtered down to BakedTileSize texels per side, 3 floats per texel, one after the other
+	std::vector<float> _bakedMaterials;
+	/// Blended materials of every block, BakedTileSize * BakedTileSize RGBA8 texels per block in the order of GetBlocks
+	std::vector<uint8_t> _bakedTiles;
+
+	void BuildGrid(Span<lnd::LNDBlock> blocks);
+	void UploadGridMaps();
+	void BuildAltitudeBounds();
+	/// Refresh the nodes of the altitude pyramid over the cells using the vertex at coordinates
+	void UpdateAltitudeBounds(const glm::u16vec2& coordinates);
+	/// Add every block using the cell as one of its vertices to blocks, cells on block edges are shared with the neighbours
+	void MarkDirty(const glm::u16vec2& coordinates, std::vector<uint16_t>& blocks);
+	/// Blend the materials of every cell of a block into its tile, see lnd::BakeTerrainBlock
+	void BakeBlock(uint16_t blockIndex);
+	void UploadBakedTile(uint16_t blockIndex);
+
 	// Renderer
 public:
 	[[nodiscard]] const std::vector<LandBlock>& GetBlocks() const { return _landBlocks; }
+	/// Vertices of all blocks, one block after the other in the order of GetBlocks
+	[[nodiscard]] const graphics::VertexBuffer& GetVertexBuffer() const { return *_vertexBuffer; }
+	[[nodiscard]] const graphics::IndexBuffer& GetIndexBuffer() const { return *_indexBuffer; }
 	[[nodiscard]] const std::vector<lnd::LNDCountry>& GetCountries() const { return _countries; }
 	[[nodiscard]] const graphics::Texture2D& GetAlbedoArray() const { return *_materialArray; }
+	/// Blended materials of every block, BakedAtlasTiles tiles per side with x along the rows of each tile
+	[[nodiscard]] const graphics::Texture2D& GetBakedAtlas() const { return *_bakedAtlas; }
+	/// Altitude of every cell of the grid, one texel per cell with x along the rows like GridIndex
+	[[nodiscard]] const graphics::Texture2D& GetAltitudeMap() const { return *_altitudeMap; }
+	/// Properties of every cell of the grid, laid out like GetAltitudeMap
+	[[nodiscard]] const graphics::Texture2D& GetCellPropertiesMap() const { return *_cellPropertiesMap; }
+	[[nodiscard]] const graphics::Texture2D& GetNoiseMap() const { return *_textureNoiseMap; }
+	/// Both material ids and the blend coefficient for every country (row) and altitude plus noise (column)
+	[[nodiscard]] const graphics::Texture2D& GetCountryLookup() const { return *_countryLookup; }
 	[[nodiscard]] const graphics::Texture2D& GetBump() const { return *_textureBumpMap; }
 	[[nodiscard]] const graphics::Texture2D& GetSmallBump() const { return *_textureSmallBump; }
 
-	uint8_t GetNoise(int x, int y);
+	[[nodiscard]] uint8_t GetNoise(int x, int y) const;
 	graphics::Texture2D* GetSmallBumpMap() { return _textureSmallBump.get(); }
 
 private:
+	std::unique_ptr<graphics::VertexBuffer> _vertexBuffer;
+	/// Indices of the full level of detail of one block, relative to its first vertex
+	std::unique_ptr<graphics::IndexBuffer> _indexBuffer;
 	std::unique_ptr<graphics::Texture2D> _materialArray;
+	std::unique_ptr<graphics::Texture2D> _bakedAtlas;
 	std::unique_ptr<graphics::Texture2D> _countryLookup;
+	std::unique_ptr<graphics::Texture2D> _altitudeMap;
+	std::unique_ptr<graphics::Texture2D> _cellPropertiesMap;
+	/// Set by edits until the grid maps are uploaded again
+	bool _gridMapsDirty {false};
 
 	std::unique_ptr<graphics::Texture2D> _textureNoiseMap;
 	std::unique_ptr<graphics::Texture2D> _textureBumpMap;
@@ -32,7 +32,7 @@ void MeshPack::LoadFromFile(const fs::path& path)
 
 	try
 	{
-		pack.Open(Game::instance()->GetFileSystem().FindPath(path).u8string());
+		pack.Open(Game::instance()->GetFileSystem().FindPath(path).u8string(), pack::PackOpenFlags::MemoryMap);
 	}
 	catch (std::runtime_error& err)
 	{
@@ -75,14 +75,14 @@ void MeshPack::loadTextures(const std::map<std::string, pack::G3DTexture>& textu
 	spdlog::debug("MeshPack loaded {0} textures", textures.size());
 }
 
-void MeshPack::loadMeshes(const std::vector<std::vector<uint8_t>>& meshes)
+void MeshPack::loadMeshes(const std::vector<Span<uint8_t>>& meshes)
 {
 	_meshes.resize(meshes.size());
 	for (uint32_t i = 0; i < _meshes.size(); i++)
 	{
 		// spdlog::debug("L3DMesh {} {}", i, MeshNames[i].data());
 		_meshes[i] = std::make_unique<L3DMesh>(MeshNames[i].data());
-		_meshes[i]->LoadFromBuffer(meshes[i]);
+		_meshes[i]->LoadFromBuffer(meshes[i].data(), meshes[i].size());
 	}
 
 	spdlog::debug("MeshPack loaded {0} meshes", meshes.size());
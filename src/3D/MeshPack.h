@@ -25,11 +25,13 @@ namespace openblack
 
 class IStream;
 class L3DMesh;
+template <typename T>
+class Span;
 
 namespace pack
 {
 struct G3DTexture;
-}
+} // namespace pack
 
 namespace graphics
 {
@@ -60,7 +62,7 @@ class MeshPack
 
 private:
 	void loadTextures(const std::map<std::string, pack::G3DTexture>& textures);
-	void loadMeshes(const std::vector<std::vector<uint8_t>>& meshes);
+	void loadMeshes(const std::vector<Span<uint8_t>>& meshes);
 
 	MeshesVec _meshes;
 	TexturesVec _textures;
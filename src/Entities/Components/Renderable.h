@@ -0,0 +1,29 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#pragma once
+
+#include "3D/MeshLookup.h"
+
+#include <cstdint>
+
+namespace openblack
+{
+
+/// Mesh an entity is drawn with, resolved once when the component which determines it is assigned
+struct Renderable
+{
+	MeshId meshId;
+	/// Submesh whose bounding box is drawn in debug, negative indices count from the last submesh
+	int8_t boundingBoxSubmesh;
+	/// Index of the instance in the instance buffer, assigned by Registry::PrepareDraw
+	uint32_t instanceSlot {0};
+};
+
+} // namespace openblack
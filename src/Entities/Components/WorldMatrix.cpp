@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#include "WorldMatrix.h"
+
+#include "Transform.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WORLD_MATRIX_SSE2
+#endif
+
+using namespace openblack;
+
+// The columns of the rotation and the position are loaded 4 floats at a time, the extra float is the next member
+static_assert(sizeof(Transform) == sizeof(float) * 15, "Transform members are expected to be tightly packed");
+
+namespace
+{
+#ifdef WORLD_MATRIX_SSE2
+/// Columns of translate(position) * mat4(rotation) * scale(scale)
+inline void ComposeColumns(const Transform& transform, __m128& column0, __m128& column1, __m128& column2,
+                           __m128& column3)
+{
+	const __m128 xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+	column0 = _mm_mul_ps(_mm_and_ps(_mm_loadu_ps(&transform.rotation[0][0]), xyzMask), _mm_set1_ps(transform.scale.x));
+	column1 = _mm_mul_ps(_mm_and_ps(_mm_loadu_ps(&transform.rotation[1][0]), xyzMask), _mm_set1_ps(transform.scale.y));
+	column2 = _mm_mul_ps(_mm_and_ps(_mm_loadu_ps(&transform.rotation[2][0]), xyzMask), _mm_set1_ps(transform.scale.z));
+	column3 = _mm_or_ps(_mm_and_ps(_mm_loadu_ps(&transform.position.x), xyzMask), _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+}
+#endif
+} // namespace
+
+void openblack::ComposeWorldMatrices(const Transform* transforms, std::size_t count, glm::mat4* matrices)
+{
+	for (std::size_t i = 0; i < count; i++)
+	{
+		const auto& transform = transforms[i];
+#ifdef WORLD_MATRIX_SSE2
+		__m128 column0, column1, column2, column3;
+		ComposeColumns(transform, column0, column1, column2, column3);
+		_mm_storeu_ps(&matrices[i][0][0], column0);
+		_mm_storeu_ps(&matrices[i][1][0], column1);
+		_mm_storeu_ps(&matrices[i][2][0], column2);
+		_mm_storeu_ps(&matrices[i][3][0], column3);
+#else
+		matrices[i][0] = glm::vec4(transform.rotation[0] * transform.scale.x, 0.0f);
+		matrices[i][1] = glm::vec4(transform.rotation[1] * transform.scale.y, 0.0f);
+		matrices[i][2] = glm::vec4(transform.rotation[2] * transform.scale.z, 0.0f);
+		matrices[i][3] = glm::vec4(transform.position, 1.0f);
+#endif
+	}
+}
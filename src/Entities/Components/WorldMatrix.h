@@ -0,0 +1,45 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#pragma once
+
+#include <glm/gtc/matrix_access.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+#include <cstddef>
+
+namespace openblack
+{
+
+struct Transform;
+
+/// Model matrix of the Transform of an entity, composed again by the registry only when the transform changes
+struct WorldMatrix
+{
+	glm::mat4 matrix;
+};
+
+/// Upper three rows of an affine model matrix with the translation in the last column, the fourth row is always 0 0 0 1
+struct AffineMatrix
+{
+	glm::vec4 rows[3];
+};
+static_assert(sizeof(AffineMatrix) == 48);
+
+/// Drop the last row of an affine matrix
+[[nodiscard]] inline AffineMatrix ToAffineMatrix(const glm::mat4& matrix)
+{
+	return {{glm::row(matrix, 0), glm::row(matrix, 1), glm::row(matrix, 2)}};
+}
+
+/// Compose the model matrices of count transforms, the same as glm::mat4(transform) for each of them
+void ComposeWorldMatrices(const Transform* transforms, std::size_t count, glm::mat4* matrices);
+
+} // namespace openblack
@@ -10,6 +10,7 @@
 #include "Registry.h"
 
 #include <algorithm>
+#include <array>
 
 #include "3D/Camera.h"
 #include "3D/L3DMesh.h"
@@ -18,9 +19,11 @@
 #include "AllMeshes.h"
 #include "Entities/Components/Abode.h"
 #include "Entities/Components/AnimatedStatic.h"
+#include "Entities/Components/Renderable.h"
 #include "Entities/Components/Stream.h"
 #include "Entities/Components/Transform.h"
 #include "Entities/Components/Tree.h"
+#include "Entities/Components/WorldMatrix.h"
 #include "Game.h"
 #include "Graphics/DebugLines.h"
 #include "Graphics/ShaderManager.h"
@@ -31,9 +34,185 @@
 namespace openblack::entities
 {
 
+namespace
+{
+// Mesh of each kind of entity and the submesh whose bounding box is drawn in debug
+Renderable MakeRenderable(const Tree& tree)
+{
+	return {treeMeshLookup[tree.treeInfo], -1};
+}
+
+Renderable MakeRenderable(const Abode& abode)
+{
+	return {abodeMeshLookup[abode.abodeInfo], 0};
+}
+
+Renderable MakeRenderable(const Villager& villager)
+{
+	return {villagerMeshLookup[villager.GetVillagerType()], 0};
+}
+
+Renderable MakeRenderable(const AnimatedStatic& animatedStatic)
+{
+	// temporary-ish:
+	MeshPackId meshId = MeshPackId::Dummy;
+	if (animatedStatic.type == "Norse Gate")
+	{
+		meshId = MeshPackId::BuildingNorseGate;
+	}
+	else if (animatedStatic.type == "Gate Stone Plinth")
+	{
+		meshId = MeshPackId::ObjectGateTotemPlinthe;
+	}
+	else if (animatedStatic.type == "Piper Cave Entrance")
+	{
+		meshId = MeshPackId::BuildingMineEntrance;
+	}
+	return {meshId, 0};
+}
+
+Renderable MakeRenderable(const MobileStatic& mobileStatic)
+{
+	return {mobileStaticMeshLookup[mobileStatic.type], 1};
+}
+
+Renderable MakeRenderable(const Feature& feature)
+{
+	return {featureMeshLookup[feature.type], 1};
+}
+
+Renderable MakeRenderable(const Field&)
+{
+	return {MeshPackId::TreeWheat, 0};
+}
+
+Renderable MakeRenderable(const Forest&)
+{
+	return {MeshPackId::FeatureForest, 0};
+}
+
+Renderable MakeRenderable(const MobileObject& mobileObject)
+{
+	return {mobileObjectMeshLookup[mobileObject.type], 1};
+}
+
+Renderable MakeRenderable(const Hand&)
+{
+	// TODO(raffclar): Handle non-mesh pack IDs via a new mechanism
+	return {999, 1};
+}
+
+// A new or different mesh moves instances between draw descs, the instances are laid out again
+template <typename Component>
+void AssignRenderable(entt::registry& registry, entt::entity entity)
+{
+	registry.emplace_or_replace<Renderable>(entity, MakeRenderable(registry.get<Component>(entity)));
+	registry.ctx<RegistryContext>().renderContext.dirty = true;
+}
+
+// Removing an instance or its transform leaves a hole in the instances, they are laid out again
+void RemoveRenderable(entt::registry& registry, entt::entity entity)
+{
+	registry.remove_if_exists<Renderable>(entity);
+	registry.ctx<RegistryContext>().renderContext.dirty = true;
+}
+
+template <typename Component>
+void ConnectRenderable(entt::registry& registry)
+{
+	registry.on_construct<Component>().template connect<&AssignRenderable<Component>>();
+	registry.on_update<Component>().template connect<&AssignRenderable<Component>>();
+	registry.on_destroy<Component>().template connect<&RemoveRenderable>();
+}
+
+/// Stable LSD radix sort of instance keys on the mesh in their upper 32 bits, a byte per pass and only as many passes
+/// as the largest mesh id needs. Returns whichever of the two buffers ends up holding the sorted keys.
+std::vector<uint64_t>& RadixSortByMesh(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch, uint32_t maxMeshId)
+{
+	scratch.resize(keys.size());
+	auto* from = &keys;
+	auto* to = &scratch;
+	for (uint32_t shift = 0; shift < 32 && (maxMeshId >> shift) != 0; shift += 8)
+	{
+		std::array<uint32_t, 256> offsets {};
+		for (const auto key : *from)
+		{
+			offsets[(key >> (32 + shift)) & 0xFF]++;
+		}
+		uint32_t sum = 0;
+		for (auto& offset : offsets)
+		{
+			const auto count = offset;
+			offset = sum;
+			sum += count;
+		}
+		for (const auto key : *from)
+		{
+			(*to)[offsets[(key >> (32 + shift)) & 0xFF]++] = key;
+		}
+		std::swap(from, to);
+	}
+	return *from;
+}
+
+const L3DMesh& GetInstanceMesh(MeshId meshId)
+{
+	// TODO(raffclar): Handle non-mesh pack IDs via a new mechanism
+	if (meshId == 999)
+	{
+		return Game::instance()->GetHandModel();
+	}
+	return Game::instance()->GetMeshPack().GetMesh(meshId);
+}
+
+/// Model matrix and bounds of the instance in slot idx and, in the second half of the uniforms, its debug bounding box
+void PrepareInstance(RenderContext& renderCtx, uint32_t idx, const Transform& transform, const glm::mat4& modelMatrix,
+                     const L3DMesh& mesh, int8_t submeshId, bool drawBoundingBox)
+{
+	renderCtx.instanceUniforms[idx] = ToAffineMatrix(modelMatrix);
+	renderCtx.instanceBounds[idx] = mesh.GetBoundingBox().transformed(modelMatrix);
+
+	if (drawBoundingBox)
+	{
+		auto box = mesh.GetSubMeshes()[(mesh.GetNumSubMeshes() + submeshId) % mesh.GetNumSubMeshes()]->GetBoundingBox();
+
+		glm::mat4 boxMatrix = glm::mat4(1.0f);
+		boxMatrix = glm::translate(boxMatrix, transform.position + box.center());
+		//			boxMatrix           = glm::rotate(boxMatrix,
+		// transform.rotation.x, glm::vec3(1.0f, 0.0f, 0.0f)); 			boxMatrix
+		// = glm::rotate(boxMatrix, transform.rotation.y,
+		// glm::vec3(0.0f, 1.0f, 0.0f)); 			boxMatrix           =
+		// glm::rotate(boxMatrix, transform.rotation.z, glm::vec3(0.0f,
+		// 0.0f, 1.0f));
+		boxMatrix = glm::scale(boxMatrix, transform.scale * box.size());
+
+		renderCtx.instanceUniforms[idx + renderCtx.instanceUniforms.size() / 2] = ToAffineMatrix(boxMatrix);
+	}
+}
+} // namespace
+
 Registry::Registry()
+    : _transformUpdates(_registry, entt::collector.update<Transform>())
+    , _worldMatrixUpdates(_registry, entt::collector.group<Transform>().update<Transform>())
 {
 	_registry.set<RegistryContext>();
+
+	// every component which determines how an entity is drawn resolves its mesh once, as it is assigned
+	ConnectRenderable<Tree>(_registry);
+	ConnectRenderable<Abode>(_registry);
+	ConnectRenderable<Villager>(_registry);
+	ConnectRenderable<AnimatedStatic>(_registry);
+	ConnectRenderable<MobileStatic>(_registry);
+	ConnectRenderable<Feature>(_registry);
+	ConnectRenderable<Field>(_registry);
+	ConnectRenderable<Forest>(_registry);
+	ConnectRenderable<MobileObject>(_registry);
+	ConnectRenderable<Hand>(_registry);
+	_registry.on_destroy<Transform>().connect<&RemoveRenderable>();
+
+	_registry.on_construct<Transform>().connect<&SpatialGrid::OnTransformConstruct>(_spatialGrid);
+	_registry.on_update<Transform>().connect<&SpatialGrid::OnTransformUpdate>(_spatialGrid);
+	_registry.on_destroy<Transform>().connect<&SpatialGrid::OnTransformDestroy>(_spatialGrid);
 }
 
 RegistryContext& Registry::Context()
@@ -46,123 +225,47 @@ const RegistryContext& Registry::Context() const
 	return _registry.ctx<RegistryContext>();
 }
 
-void Registry::PrepareDrawDescs(bool drawBoundingBox)
+void Registry::UpdateWorldMatrices()
 {
-	// Count number of instances
-	uint32_t instanceCount = 0;
-	std::map<MeshId, uint32_t> meshIds;
-
-	// Trees
-	_registry.view<const Tree, const Transform>().each(
-	    [&meshIds, &instanceCount](const Tree& entity, const Transform& transform) {
-		    const auto meshId = treeMeshLookup[entity.treeInfo];
-		    auto count = meshIds.insert(std::make_pair(meshId, 0));
-		    count.first->second++;
-		    instanceCount++;
-	    });
-
-	// Abodes
-	_registry.view<const Abode, const Transform>().each(
-	    [&meshIds, &instanceCount](const Abode& entity, const Transform& transform) {
-		    const auto meshId = abodeMeshLookup[entity.abodeInfo];
-		    auto count = meshIds.insert(std::make_pair(meshId, 0));
-		    count.first->second++;
-		    instanceCount++;
-	    });
-
-	// Villagers
-	_registry.view<const Villager, const Transform>().each(
-	    [&meshIds, &instanceCount](const Villager& villager, const Transform& transform) {
-		    const auto villagerType = villager.GetVillagerType();
-		    const auto meshId = villagerMeshLookup[villagerType];
-		    auto count = meshIds.insert(std::make_pair(meshId, 0));
-		    count.first->second++;
-		    instanceCount++;
-	    });
-
-	// Animated Statics
-	_registry.view<const AnimatedStatic, const Transform>().each(
-	    [&meshIds, &instanceCount](const AnimatedStatic& entity, const Transform& transform) {
-		    // temporary-ish:
-		    MeshPackId meshId = MeshPackId::Dummy;
-		    if (entity.type == "Norse Gate")
-		    {
-			    meshId = MeshPackId::BuildingNorseGate;
-		    }
-		    else if (entity.type == "Gate Stone Plinth")
-		    {
-			    meshId = MeshPackId::ObjectGateTotemPlinthe;
-		    }
-		    else if (entity.type == "Piper Cave Entrance")
-		    {
-			    meshId = MeshPackId::BuildingMineEntrance;
-		    }
-		    auto count = meshIds.insert(std::make_pair(static_cast<MeshId>(meshId), 0));
-		    count.first->second++;
-		    instanceCount++;
-	    });
-
-	// Mobile Statics
-	_registry.view<const MobileStatic, const Transform>().each(
-	    [&meshIds, &instanceCount](const MobileStatic& entity, const Transform& transform) {
-		    const auto meshId = mobileStaticMeshLookup[entity.type];
-		    auto count = meshIds.insert(std::make_pair(meshId, 0));
-		    count.first->second++;
-		    instanceCount++;
-	    });
-
-	// Features
-	_registry.view<const Feature, const Transform>().each(
-	    [&meshIds, &instanceCount](const Feature& entity, const Transform& transform) {
-		    const auto meshId = featureMeshLookup[entity.type];
-		    auto count = meshIds.insert(std::make_pair(meshId, 0));
-		    count.first->second++;
-		    instanceCount++;
-	    });
-
-	// Fields
-	_registry.view<const Field, const Transform>().each(
-	    [&meshIds, &instanceCount](const Field& entity, const Transform& transform) {
-		    const auto meshId = MeshPackId::TreeWheat;
-		    auto count = meshIds.insert(std::make_pair(static_cast<MeshId>(meshId), 0));
-		    count.first->second++;
-		    instanceCount++;
-	    });
-
-	// Forests
-	_registry.view<const Forest, const Transform>().each(
-	    [&meshIds, &instanceCount](const Forest& entity, const Transform& transform) {
-		    const auto meshId = MeshPackId::FeatureForest;
-		    auto count = meshIds.insert(std::make_pair(static_cast<MeshId>(meshId), 0));
-		    count.first->second++;
-		    instanceCount++;
-	    });
-
-	// Mobile Objects
-	_registry.view<const MobileObject, const Transform>().each(
-	    [&meshIds, &instanceCount](const MobileObject& entity, const Transform& transform) {
-		    const auto meshId = mobileObjectMeshLookup[entity.type];
-		    auto count = meshIds.insert(std::make_pair(meshId, 0));
-		    count.first->second++;
-		    instanceCount++;
-	    });
-
-	// Hands
-	_registry.view<const Hand, const Transform>().each(
-	    [&meshIds, &instanceCount](const Hand& entity, const Transform& transform) {
-		    const auto meshId = MeshId(999);
-		    auto count = meshIds.insert(std::make_pair(meshId, 0));
-		    count.first->second++;
-		    instanceCount++;
-	    });
+	// Compose the matrices of the transforms assigned or patched since the last call straight into their components
+	for (const auto entity : _worldMatrixUpdates)
+	{
+		const auto& transform = _registry.get<const Transform>(entity);
+		auto* worldMatrix = _registry.try_get<WorldMatrix>(entity);
+		if (worldMatrix == nullptr)
+		{
+			worldMatrix = &_registry.emplace<WorldMatrix>(entity);
+		}
+		ComposeWorldMatrices(&transform, 1, &worldMatrix->matrix);
+	}
+	_worldMatrixUpdates.clear();
+}
+
+void Registry::PrepareDrawInstances(bool drawBoundingBox)
+{
+	auto& renderCtx = Context().renderContext;
 
+	// A key per instance with the mesh in the upper half and the entity in the lower half, sorted by mesh so the
+	// instances of each mesh are contiguous
+	auto& keys = renderCtx.instanceKeys;
+	keys.clear();
+	uint32_t maxMeshId = 0;
+	auto view = _registry.view<Renderable, const Transform, const WorldMatrix>();
+	for (const auto entity : view)
+	{
+		const auto meshId = static_cast<uint32_t>(static_cast<int>(view.get<Renderable>(entity).meshId));
+		maxMeshId = std::max(maxMeshId, meshId);
+		keys.push_back(static_cast<uint64_t>(meshId) << 32 | entt::to_integral(entity));
+	}
+	const auto& sortedKeys = RadixSortByMesh(keys, renderCtx.instanceKeysScratch, maxMeshId);
+
+	auto instanceCount = static_cast<uint32_t>(sortedKeys.size());
+	renderCtx.instanceBounds.resize(instanceCount);
 	if (drawBoundingBox)
 	{
 		instanceCount *= 2;
 	}
 
-	auto& renderCtx = Context().renderContext;
-
 	// Recreate instancing uniform buffer if it is too small
 	if (renderCtx.instanceUniforms.size() < instanceCount)
 	{
@@ -175,180 +278,82 @@ void Registry::PrepareDrawDescs(bool drawBoundingBox)
 		    .add(bgfx::Attrib::TexCoord7, 4, bgfx::AttribType::Float)
 		    .add(bgfx::Attrib::TexCoord6, 4, bgfx::AttribType::Float)
 		    .add(bgfx::Attrib::TexCoord5, 4, bgfx::AttribType::Float)
-		    .add(bgfx::Attrib::TexCoord4, 4, bgfx::AttribType::Float)
 		    .end();
 		renderCtx.instanceUniformBuffer = bgfx::createDynamicVertexBuffer(instanceCount, layout);
 		renderCtx.instanceUniforms.resize(instanceCount);
 	}
 
-	// Determine uniform buffer offsets and instance count for draw
-	uint32_t offset = 0;
+	// Walk the sorted instances once, starting a draw desc whenever the mesh changes. Each entity keeps its slot until
+	// the instances are laid out again, so later changes of its transform only rewrite that slot.
 	renderCtx.instancedDrawDescs.clear();
-	for (const auto& [meshId, count] : meshIds)
+	const L3DMesh* mesh = nullptr;
+	for (uint32_t i = 0; i < sortedKeys.size(); i++)
 	{
-		renderCtx.instancedDrawDescs.emplace(std::piecewise_construct, std::forward_as_tuple(meshId),
-		                                     std::forward_as_tuple(offset, count));
-		offset += count;
+		const auto meshId = static_cast<MeshId::IdType>(sortedKeys[i] >> 32);
+		if (renderCtx.instancedDrawDescs.empty() || renderCtx.instancedDrawDescs.back().first != meshId)
+		{
+			mesh = &GetInstanceMesh(meshId);
+			renderCtx.instancedDrawDescs.emplace_back(std::piecewise_construct, std::forward_as_tuple(meshId),
+			                                          std::forward_as_tuple(i, 0));
+		}
+		renderCtx.instancedDrawDescs.back().second.count++;
+
+		const auto entity = static_cast<entt::entity>(sortedKeys[i] & 0xFFFFFFFF);
+		auto& renderable = view.get<Renderable>(entity);
+		renderable.instanceSlot = i;
+		PrepareInstance(renderCtx, i, view.get<const Transform>(entity), view.get<const WorldMatrix>(entity).matrix, *mesh,
+		                renderable.boundingBoxSubmesh, drawBoundingBox);
+	}
+
+	if (!renderCtx.instanceUniforms.empty())
+	{
+		const auto size = static_cast<uint32_t>(renderCtx.instanceUniforms.size() * sizeof(AffineMatrix));
+		bgfx::update(renderCtx.instanceUniformBuffer, 0, bgfx::makeRef(renderCtx.instanceUniforms.data(), size));
 	}
 }
 
-void Registry::PrepareDrawUploadUniforms(bool drawBoundingBox)
+void Registry::PrepareDrawUpdateInstances(bool drawBoundingBox)
 {
 	auto& renderCtx = Context().renderContext;
 
-	// Set transforms for instanced draw at offsets
-	auto prepareDrawBoundingBox = [&renderCtx, drawBoundingBox](uint32_t idx, const Transform& transform, MeshId meshId,
-	                                                            int8_t submeshId) {
-		if (drawBoundingBox)
+	// Rewrite the slots of the instances whose transform was patched since the last PrepareDraw
+	auto& slots = renderCtx.updatedSlots;
+	slots.clear();
+	for (const auto entity : _transformUpdates)
+	{
+		if (!_registry.has<Renderable>(entity))
 		{
-			const L3DMesh& mesh = Game::instance()->GetMeshPack().GetMesh(meshId);
-			auto box = mesh.GetSubMeshes()[(mesh.GetNumSubMeshes() + submeshId) % mesh.GetNumSubMeshes()]->GetBoundingBox();
-
-			glm::mat4 boxMatrix = glm::mat4(1.0f);
-			boxMatrix = glm::translate(boxMatrix, transform.position + box.center());
-			//			boxMatrix           = glm::rotate(boxMatrix,
-			// transform.rotation.x, glm::vec3(1.0f, 0.0f, 0.0f)); 			boxMatrix
-			// = glm::rotate(boxMatrix, transform.rotation.y,
-			// glm::vec3(0.0f, 1.0f, 0.0f)); 			boxMatrix           =
-			// glm::rotate(boxMatrix, transform.rotation.z, glm::vec3(0.0f,
-			// 0.0f, 1.0f));
-			boxMatrix = glm::scale(boxMatrix, transform.scale * box.size());
-
-			renderCtx.instanceUniforms[idx + renderCtx.instanceUniforms.size() / 2] = boxMatrix;
+			continue;
 		}
-	};
-	// Store offsets of uniforms for descs
-	std::map<MeshId, uint32_t> uniformOffsets;
-
-	// Trees
-	_registry.view<const Tree, const Transform>().each(
-	    [&renderCtx, &uniformOffsets, prepareDrawBoundingBox](const Tree& entity, const Transform& transform) {
-		    const auto meshId = treeMeshLookup[entity.treeInfo];
-		    auto offset = uniformOffsets.insert(std::make_pair(meshId, 0));
-		    auto desc = renderCtx.instancedDrawDescs.find(meshId);
-		    renderCtx.instanceUniforms[desc->second.offset + offset.first->second] = static_cast<glm::mat4>(transform);
-		    prepareDrawBoundingBox(desc->second.offset + offset.first->second, transform, meshId, -1);
-		    offset.first->second++;
-	    });
-
-	// Abodes
-	_registry.view<const Abode, const Transform>().each(
-	    [&renderCtx, &uniformOffsets, prepareDrawBoundingBox](const Abode& entity, const Transform& transform) {
-		    const auto meshId = abodeMeshLookup[entity.abodeInfo];
-		    auto offset = uniformOffsets.insert(std::make_pair(meshId, 0));
-		    auto desc = renderCtx.instancedDrawDescs.find(meshId);
-		    renderCtx.instanceUniforms[desc->second.offset + offset.first->second] = static_cast<glm::mat4>(transform);
-		    prepareDrawBoundingBox(desc->second.offset + offset.first->second, transform, meshId, 0);
-		    offset.first->second++;
-	    });
-
-	// Villagers
-	_registry.view<const Villager, const Transform>().each(
-	    [this, &renderCtx, &uniformOffsets, prepareDrawBoundingBox](const Villager& villager, const Transform& transform) {
-		    const auto villagerType = villager.GetVillagerType();
-		    const auto meshId = villagerMeshLookup[villagerType];
-		    auto offset = uniformOffsets.insert(std::make_pair(meshId, 0));
-		    auto desc = renderCtx.instancedDrawDescs.find(meshId);
-		    renderCtx.instanceUniforms[desc->second.offset + offset.first->second] = static_cast<glm::mat4>(transform);
-		    prepareDrawBoundingBox(desc->second.offset + offset.first->second, transform, meshId, 0);
-		    offset.first->second++;
-	    });
-
-	// Animated Statics
-	_registry.view<const AnimatedStatic, const Transform>().each(
-	    [&renderCtx, &uniformOffsets, prepareDrawBoundingBox](const AnimatedStatic& entity, const Transform& transform) {
-		    // temporary-ish:
-		    MeshPackId meshPackId = MeshPackId::Dummy;
-		    if (entity.type == "Norse Gate")
-		    {
-			    meshPackId = MeshPackId::BuildingNorseGate;
-		    }
-		    else if (entity.type == "Gate Stone Plinth")
-		    {
-			    meshPackId = MeshPackId::ObjectGateTotemPlinthe;
-		    }
-		    else if (entity.type == "Piper Cave Entrance")
-		    {
-			    meshPackId = MeshPackId::BuildingMineEntrance;
-		    }
-		    auto meshId = static_cast<MeshId>(meshPackId);
-		    auto offset = uniformOffsets.insert(std::make_pair(meshId, 0));
-		    auto desc = renderCtx.instancedDrawDescs.find(meshId);
-		    renderCtx.instanceUniforms[desc->second.offset + offset.first->second] = static_cast<glm::mat4>(transform);
-		    prepareDrawBoundingBox(desc->second.offset + offset.first->second, transform, meshId, 0);
-		    offset.first->second++;
-	    });
-
-	// Mobile Statics
-	_registry.view<const MobileStatic, const Transform>().each(
-	    [&renderCtx, &uniformOffsets, prepareDrawBoundingBox](const MobileStatic& entity, const Transform& transform) {
-		    const auto meshId = mobileStaticMeshLookup[entity.type];
-		    auto offset = uniformOffsets.insert(std::make_pair(meshId, 0));
-		    auto desc = renderCtx.instancedDrawDescs.find(meshId);
-		    renderCtx.instanceUniforms[desc->second.offset + offset.first->second] = static_cast<glm::mat4>(transform);
-		    prepareDrawBoundingBox(desc->second.offset + offset.first->second, transform, meshId, 1);
-		    offset.first->second++;
-	    });
-
-	// Features
-	_registry.view<const Feature, const Transform>().each(
-	    [&renderCtx, &uniformOffsets, prepareDrawBoundingBox](const Feature& entity, const Transform& transform) {
-		    const auto meshId = featureMeshLookup[entity.type];
-		    auto offset = uniformOffsets.insert(std::make_pair(meshId, 0));
-		    auto desc = renderCtx.instancedDrawDescs.find(meshId);
-		    renderCtx.instanceUniforms[desc->second.offset + offset.first->second] = static_cast<glm::mat4>(transform);
-		    prepareDrawBoundingBox(desc->second.offset + offset.first->second, transform, meshId, 1);
-		    offset.first->second++;
-	    });
-
-	// Fields
-	_registry.view<const Field, const Transform>().each(
-	    [&renderCtx, &uniformOffsets, prepareDrawBoundingBox](const Field& entity, const Transform& transform) {
-		    const MeshId meshId = static_cast<MeshId>(MeshPackId::TreeWheat);
-		    auto offset = uniformOffsets.insert(std::make_pair(meshId, 0));
-		    auto desc = renderCtx.instancedDrawDescs.find(meshId);
-		    renderCtx.instanceUniforms[desc->second.offset + offset.first->second] = static_cast<glm::mat4>(transform);
-		    prepareDrawBoundingBox(desc->second.offset + offset.first->second, transform, meshId, 0);
-		    offset.first->second++;
-	    });
-
-	// Forests
-	_registry.view<const Forest, const Transform>().each(
-	    [&renderCtx, &uniformOffsets, prepareDrawBoundingBox](const Forest& entity, const Transform& transform) {
-		    const MeshId meshId = static_cast<MeshId>(MeshPackId::FeatureForest);
-		    auto offset = uniformOffsets.insert(std::make_pair(meshId, 0));
-		    auto desc = renderCtx.instancedDrawDescs.find(meshId);
-		    renderCtx.instanceUniforms[desc->second.offset + offset.first->second] = static_cast<glm::mat4>(transform);
-		    prepareDrawBoundingBox(desc->second.offset + offset.first->second, transform, meshId, 0);
-		    offset.first->second++;
-	    });
-
-	// Mobile Objects
-	_registry.view<const MobileObject, const Transform>().each(
-	    [&renderCtx, &uniformOffsets, prepareDrawBoundingBox](const MobileObject& entity, const Transform& transform) {
-		    const auto meshId = mobileObjectMeshLookup[entity.type];
-		    auto offset = uniformOffsets.insert(std::make_pair(meshId, 0));
-		    auto desc = renderCtx.instancedDrawDescs.find(meshId);
-		    renderCtx.instanceUniforms[desc->second.offset + offset.first->second] = static_cast<glm::mat4>(transform);
-		    prepareDrawBoundingBox(desc->second.offset + offset.first->second, transform, meshId, 1);
-		    offset.first->second++;
-	    });
-
-	// Hands
-	_registry.view<const Hand, const Transform>().each(
-	    [&renderCtx, &uniformOffsets, prepareDrawBoundingBox](const Hand& entity, const Transform& transform) {
-		    MeshId meshId = 999;
-		    auto offset = uniformOffsets.insert(std::make_pair(meshId, 0));
-		    auto desc = renderCtx.instancedDrawDescs.find(meshId);
-		    renderCtx.instanceUniforms[desc->second.offset + offset.first->second] = static_cast<glm::mat4>(transform);
-		    prepareDrawBoundingBox(desc->second.offset + offset.first->second, transform, meshId, 1);
-		    offset.first->second++;
-	    });
+		const auto& renderable = _registry.get<const Renderable>(entity);
+		PrepareInstance(renderCtx, renderable.instanceSlot, _registry.get<const Transform>(entity),
+		                _registry.get<const WorldMatrix>(entity).matrix, GetInstanceMesh(renderable.meshId),
+		                renderable.boundingBoxSubmesh, drawBoundingBox);
+		slots.push_back(renderable.instanceSlot);
+	}
+	_transformUpdates.clear();
 
-	if (!renderCtx.instanceUniforms.empty())
+	// Upload runs of consecutive slots, and the bounding boxes at the same distance in the second half. The runs are copied
+	// as the render thread may still be reading them when the slots are prepared again next frame.
+	std::sort(slots.begin(), slots.end());
+	for (size_t first = 0; first < slots.size();)
 	{
-		bgfx::update(renderCtx.instanceUniformBuffer, 0,
-		             bgfx::makeRef(renderCtx.instanceUniforms.data(), renderCtx.instanceUniforms.size() * sizeof(glm::mat4)));
+		size_t last = first + 1;
+		while (last < slots.size() && slots[last] == slots[last - 1] + 1)
+		{
+			last++;
+		}
+		const auto start = slots[first];
+		const auto count = static_cast<uint32_t>(last - first);
+		bgfx::update(renderCtx.instanceUniformBuffer, start,
+		             bgfx::copy(&renderCtx.instanceUniforms[start], count * sizeof(AffineMatrix)));
+		if (drawBoundingBox)
+		{
+			const auto boxStart = static_cast<uint32_t>(start + renderCtx.instanceUniforms.size() / 2);
+			bgfx::update(renderCtx.instanceUniformBuffer, boxStart,
+			             bgfx::copy(&renderCtx.instanceUniforms[boxStart], count * sizeof(AffineMatrix)));
+		}
+		first = last;
 	}
 }
 
@@ -356,11 +361,16 @@ void Registry::PrepareDraw(bool drawBoundingBox, bool drawFootpaths, bool drawSt
 {
 	auto& renderCtx = Context().renderContext;
 
+	if (!_worldMatrixUpdates.empty())
+	{
+		UpdateWorldMatrices();
+	}
+
 	if (renderCtx.dirty || renderCtx.hasBoundingBoxes != drawBoundingBox || (renderCtx.footpaths != nullptr) != drawFootpaths ||
 	    (renderCtx.streams != nullptr) != drawStreams)
 	{
-		PrepareDrawDescs(drawBoundingBox);
-		PrepareDrawUploadUniforms(drawBoundingBox);
+		PrepareDrawInstances(drawBoundingBox);
+		_transformUpdates.clear();
 
 		renderCtx.boundingBox.reset();
 		if (drawBoundingBox)
@@ -425,11 +435,15 @@ void Registry::PrepareDraw(bool drawBoundingBox, bool drawFootpaths, bool drawSt
 		renderCtx.dirty = false;
 		renderCtx.hasBoundingBoxes = drawBoundingBox;
 	}
+	else if (!_transformUpdates.empty())
+	{
+		PrepareDrawUpdateInstances(drawBoundingBox);
+	}
 }
 
 void Registry::SetDirty()
 {
 	auto& renderCtx = Context().renderContext;
-	renderCtx.dirty = false;
+	renderCtx.dirty = true;
 }
 } // namespace openblack::entities
@@ -8,14 +8,19 @@
  *****************************************************************************/
 
 #include "Entities/RegistryContext.h"
+#include "Entities/SpatialGrid.h"
 #include "Graphics/RenderPass.h"
 
 #include <entt/entt.hpp>
 
+#include <type_traits>
+#include <utility>
+
 namespace openblack
 {
 class Camera;
-}
+struct Transform;
+} // namespace openblack
 
 namespace openblack::graphics
 {
@@ -41,6 +46,8 @@ class Registry
 	void SetDirty();
 	RegistryContext& Context();
 	[[nodiscard]] const RegistryContext& Context() const;
+	/// Positions of every entity with a Transform, kept up to date as transforms are assigned or patched
+	[[nodiscard]] const SpatialGrid& GetSpatialGrid() const { return _spatialGrid; }
 	void Reset()
 	{
 		SetDirty();
@@ -52,17 +59,39 @@ class Registry
 	{
 		return _registry.size<Component>();
 	}
+	/// Transforms are returned read only, change them with Patch so that their
+	/// world matrix, instance and grid cell follow.
 	template <typename Component>
 	decltype(auto) Get(entt::entity entity)
 	{
-		return _registry.get<Component>(entity);
+		if constexpr (std::is_same_v<Component, Transform>)
+		{
+			return std::as_const(_registry).get<Component>(entity);
+		}
+		else
+		{
+			return _registry.get<Component>(entity);
+		}
+	}
+	/// Modify a component in place. Patched transforms are picked up by the next
+	/// PrepareDraw which only uploads the instances of the patched entities.
+	template <typename Component, typename... Func>
+	decltype(auto) Patch(entt::entity entity, Func&&... func)
+	{
+		return _registry.patch<Component>(entity, std::forward<Func>(func)...);
 	}
 
 private:
-	void PrepareDrawDescs(bool drawBoundingBox);
-	void PrepareDrawUploadUniforms(bool drawBoundingBox);
+	void UpdateWorldMatrices();
+	void PrepareDrawInstances(bool drawBoundingBox);
+	void PrepareDrawUpdateInstances(bool drawBoundingBox);
 
 	entt::registry _registry;
+	SpatialGrid _spatialGrid;
+	/// Entities whose Transform was patched since the last PrepareDraw
+	entt::observer _transformUpdates;
+	/// Entities whose WorldMatrix is out of date with their Transform
+	entt::observer _worldMatrixUpdates;
 };
 
 } // namespace openblack::entities
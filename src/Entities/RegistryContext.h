@@ -7,7 +7,9 @@
  * openblack is licensed under the GNU General Public License version 3.
  *****************************************************************************/
 
+#include "3D/AxisAlignedBoundingBox.h"
 #include "AllMeshes.h"
+#include "Entities/Components/WorldMatrix.h"
 #include "Graphics/DebugLines.h"
 
 #include <bgfx/bgfx.h>
@@ -15,9 +17,9 @@
 #include <glm/fwd.hpp>
 
 #include <3D/MeshLookup.h>
-#include <map>
 #include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace openblack::entities
@@ -53,9 +55,21 @@ struct RenderContext
 	/// but in practice, it should only grow its reserved memory.
 	/// If debug bounding boxes are enabled, it will double in size to fit all
 	/// bounding boxes in the second half of the list.
-	std::vector<glm::mat4> instanceUniforms;
+	/// Model matrices are stored as their upper three rows, 48 bytes instead
+	/// of 64, which is what vs_object_instanced and vs_line_instanced read.
+	std::vector<AffineMatrix> instanceUniforms;
+	/// World space bounds of every instance at the same index as its uniforms,
+	/// which the renderer culls against the frustum of each view.
+	std::vector<AxisAlignedBoundingBox> instanceBounds;
 	/// Stores information for rendering which is prepared at \ref PrepareDraw.
-	std::map<MeshId, const InstancedDrawDesc> instancedDrawDescs;
+	/// One per mesh with instances, in increasing order of mesh.
+	std::vector<std::pair<MeshId, InstancedDrawDesc>> instancedDrawDescs;
+	/// Mesh and entity of every instance, sorted by mesh at every \ref PrepareDraw.
+	/// Both lists are kept so the sort does not allocate once they are large enough.
+	std::vector<uint64_t> instanceKeys;
+	std::vector<uint64_t> instanceKeysScratch;
+	/// Instances whose transform changed since the last \ref PrepareDraw.
+	std::vector<uint32_t> updatedSlots;
 	/// Not an actual vertex buffer, but a dynamic general purpose buffer which
 	/// stores uniform data as a GPU-side copy of \ref _instanceUniforms and
 	/// which is populated in \ref PrepareDraw and consumed in \ref DrawModels.
@@ -65,6 +79,8 @@ struct RenderContext
 	/// the instances of entities and their bounding boxes.
 	bgfx::DynamicVertexBufferHandle instanceUniformBuffer;
 
+	/// Set when entities or their meshes change and the instances must be laid
+	/// out again. Moving an entity only needs Registry::Patch on its Transform.
 	bool dirty {true};
 	bool hasBoundingBoxes {false};
 };
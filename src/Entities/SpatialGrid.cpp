@@ -0,0 +1,264 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#include "SpatialGrid.h"
+
+#include "3D/Frustum.h"
+#include "Entities/Components/Transform.h"
+
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <queue>
+#include <utility>
+
+using namespace openblack;
+using namespace openblack::entities;
+
+namespace
+{
+const AxisAlignedBoundingBox EmptyBounds {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)};
+}
+
+SpatialGrid::SpatialGrid()
+    : _cells(CellsPerSide * CellsPerSide)
+    , _cellBounds(CellsPerSide * CellsPerSide, EmptyBounds)
+{
+}
+
+uint16_t SpatialGrid::GetCellCoordinate(float coordinate)
+{
+	const float cell = std::floor(coordinate / CellSize);
+	return static_cast<uint16_t>(std::clamp(cell, 0.0f, static_cast<float>(CellsPerSide - 1)));
+}
+
+uint32_t SpatialGrid::GetCellIndex(const glm::vec3& position)
+{
+	return GetCellIndex(GetCellCoordinate(position.x), GetCellCoordinate(position.z));
+}
+
+void SpatialGrid::Insert(entt::entity entity, const glm::vec3& position)
+{
+	if (_locations.find(entity) != _locations.end())
+	{
+		Move(entity, position);
+		return;
+	}
+
+	const auto cell = GetCellIndex(position);
+	_locations[entity] = {cell, static_cast<uint32_t>(_cells[cell].size())};
+	_cells[cell].push_back({entity, position});
+	_cellBounds[cell].minima = glm::min(_cellBounds[cell].minima, position);
+	_cellBounds[cell].maxima = glm::max(_cellBounds[cell].maxima, position);
+}
+
+void SpatialGrid::Move(entt::entity entity, const glm::vec3& position)
+{
+	const auto location = _locations.find(entity);
+	if (location == _locations.end())
+	{
+		Insert(entity, position);
+		return;
+	}
+
+	const auto cell = GetCellIndex(position);
+	if (cell != location->second.cell)
+	{
+		Remove(entity);
+		Insert(entity, position);
+		return;
+	}
+
+	_cells[cell][location->second.index].position = position;
+	_cellBounds[cell].minima = glm::min(_cellBounds[cell].minima, position);
+	_cellBounds[cell].maxima = glm::max(_cellBounds[cell].maxima, position);
+}
+
+void SpatialGrid::Remove(entt::entity entity)
+{
+	const auto location = _locations.find(entity);
+	if (location == _locations.end())
+	{
+		return;
+	}
+
+	// the last entry of the cell takes the place of the removed one
+	auto& entries = _cells[location->second.cell];
+	const auto index = location->second.index;
+	if (index + 1 != entries.size())
+	{
+		entries[index] = entries.back();
+		_locations[entries[index].entity].index = index;
+	}
+	entries.pop_back();
+	if (entries.empty())
+	{
+		_cellBounds[location->second.cell] = EmptyBounds;
+	}
+	_locations.erase(location);
+}
+
+void SpatialGrid::Clear()
+{
+	for (auto& entries : _cells)
+	{
+		entries.clear();
+	}
+	std::fill(_cellBounds.begin(), _cellBounds.end(), EmptyBounds);
+	_locations.clear();
+}
+
+void SpatialGrid::OnTransformConstruct(entt::registry& registry, entt::entity entity)
+{
+	Insert(entity, registry.get<const Transform>(entity).position);
+}
+
+void SpatialGrid::OnTransformUpdate(entt::registry& registry, entt::entity entity)
+{
+	Move(entity, registry.get<const Transform>(entity).position);
+}
+
+void SpatialGrid::OnTransformDestroy([[maybe_unused]] entt::registry& registry, entt::entity entity)
+{
+	Remove(entity);
+}
+
+template <typename Function>
+void SpatialGrid::ForEachEntry(float minimumX, float minimumZ, float maximumX, float maximumZ, Function function) const
+{
+	const auto firstX = GetCellCoordinate(minimumX);
+	const auto firstZ = GetCellCoordinate(minimumZ);
+	const auto lastX = GetCellCoordinate(maximumX);
+	const auto lastZ = GetCellCoordinate(maximumZ);
+	for (uint16_t x = firstX; x <= lastX; x++)
+	{
+		for (uint16_t z = firstZ; z <= lastZ; z++)
+		{
+			for (const auto& entry : _cells[GetCellIndex(x, z)])
+			{
+				function(entry);
+			}
+		}
+	}
+}
+
+void SpatialGrid::QueryRadius(const glm::vec3& center, float radius, std::vector<entt::entity>& result) const
+{
+	const float radiusSquared = radius * radius;
+	ForEachEntry(center.x - radius, center.z - radius, center.x + radius, center.z + radius,
+	             [&center, radiusSquared, &result](const Entry& entry) {
+		             const auto offset = entry.position - center;
+		             if (glm::dot(offset, offset) <= radiusSquared)
+		             {
+			             result.push_back(entry.entity);
+		             }
+	             });
+}
+
+void SpatialGrid::QueryBox(const AxisAlignedBoundingBox& box, std::vector<entt::entity>& result) const
+{
+	ForEachEntry(box.minima.x, box.minima.z, box.maxima.x, box.maxima.z, [&box, &result](const Entry& entry) {
+		if (glm::all(glm::greaterThanEqual(entry.position, box.minima)) &&
+		    glm::all(glm::lessThanEqual(entry.position, box.maxima)))
+		{
+			result.push_back(entry.entity);
+		}
+	});
+}
+
+void SpatialGrid::QueryFrustum(const Frustum& frustum, float margin, std::vector<entt::entity>& result) const
+{
+	const glm::vec3 extent(margin);
+	for (uint32_t cell = 0; cell < _cells.size(); cell++)
+	{
+		const auto& bounds = _cellBounds[cell];
+		if (_cells[cell].empty() || !frustum.Intersects({bounds.minima - extent, bounds.maxima + extent}))
+		{
+			continue;
+		}
+		for (const auto& entry : _cells[cell])
+		{
+			if (frustum.Intersects({entry.position - extent, entry.position + extent}))
+			{
+				result.push_back(entry.entity);
+			}
+		}
+	}
+}
+
+void SpatialGrid::QueryNearest(const glm::vec3& position, std::size_t count, std::vector<entt::entity>& result) const
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// Rings of cells around the cell of position are visited outwards, keeping the closest entities found so far in a
+	// max heap. The search stops once no entity past the current ring can be closer than the furthest one kept.
+	std::priority_queue<std::pair<float, entt::entity>> closest;
+	const int centerX = GetCellCoordinate(position.x);
+	const int centerZ = GetCellCoordinate(position.z);
+	for (int ring = 0; ring < CellsPerSide; ring++)
+	{
+		if (closest.size() == count)
+		{
+			// anything outside the square of the inner rings is at least this far away
+			const float left = position.x - static_cast<float>(centerX - ring + 1) * CellSize;
+			const float right = static_cast<float>(centerX + ring) * CellSize - position.x;
+			const float bottom = position.z - static_cast<float>(centerZ - ring + 1) * CellSize;
+			const float top = static_cast<float>(centerZ + ring) * CellSize - position.z;
+			const float distance = std::max(0.0f, std::min({left, right, bottom, top}));
+			if (distance * distance > closest.top().first)
+			{
+				break;
+			}
+		}
+
+		for (int x = centerX - ring; x <= centerX + ring; x++)
+		{
+			if (x < 0 || x >= CellsPerSide)
+			{
+				continue;
+			}
+			// only the edges of the ring, the inside was visited by the previous rings
+			const int step = (x == centerX - ring || x == centerX + ring || ring == 0) ? 1 : 2 * ring;
+			for (int z = centerZ - ring; z <= centerZ + ring; z += step)
+			{
+				if (z < 0 || z >= CellsPerSide)
+				{
+					continue;
+				}
+				for (const auto& entry : _cells[GetCellIndex(static_cast<uint16_t>(x), static_cast<uint16_t>(z))])
+				{
+					const auto offset = entry.position - position;
+					const float distanceSquared = glm::dot(offset, offset);
+					if (closest.size() < count)
+					{
+						closest.emplace(distanceSquared, entry.entity);
+					}
+					else if (distanceSquared < closest.top().first)
+					{
+						closest.pop();
+						closest.emplace(distanceSquared, entry.entity);
+					}
+				}
+			}
+		}
+	}
+
+	const auto first = result.size();
+	for (; !closest.empty(); closest.pop())
+	{
+		result.push_back(closest.top().second);
+	}
+	std::reverse(result.begin() + static_cast<std::ptrdiff_t>(first), result.end());
+}
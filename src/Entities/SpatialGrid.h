@@ -0,0 +1,96 @@
+/*****************************************************************************
+ * Copyright (c) 2018-2020 openblack developers
+ *
+ * For a complete list of all authors, please refer to contributors.md
+ * Interested in contributing? Visit https://github.com/openblack/openblack
+ *
+ * openblack is licensed under the GNU General Public License version 3.
+ *****************************************************************************/
+
+#pragma once
+
+#include "3D/AxisAlignedBoundingBox.h"
+
+#include <entt/entity/fwd.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace openblack
+{
+struct Frustum;
+}
+
+namespace openblack::entities
+{
+
+/**
+  Uniform grid over the island of the positions of every entity with a Transform.
+
+  Cells are 8 by 8 cells of the island, positions outside of it are kept in the edge cells. The registry keeps the grid
+  up to date as transforms are assigned, patched or removed, queries only visit the cells they overlap.
+ */
+class SpatialGrid
+{
+public:
+	/// Side of a cell in world units, 8 island cells
+	static constexpr float CellSize = 80.0f;
+	/// Cells per side, enough for the 512 cells of the island
+	static constexpr uint16_t CellsPerSide = 64;
+
+	SpatialGrid();
+
+	void Insert(entt::entity entity, const glm::vec3& position);
+	void Move(entt::entity entity, const glm::vec3& position);
+	void Remove(entt::entity entity);
+	void Clear();
+
+	/// Signal handlers for the Transform of the registry
+	void OnTransformConstruct(entt::registry& registry, entt::entity entity);
+	void OnTransformUpdate(entt::registry& registry, entt::entity entity);
+	void OnTransformDestroy(entt::registry& registry, entt::entity entity);
+
+	[[nodiscard]] std::size_t Size() const { return _locations.size(); }
+
+	/// Append the entities within radius of center
+	void QueryRadius(const glm::vec3& center, float radius, std::vector<entt::entity>& result) const;
+	/// Append the entities whose position lies inside box
+	void QueryBox(const AxisAlignedBoundingBox& box, std::vector<entt::entity>& result) const;
+	/// Append the entities whose position, grown by margin on every axis, intersects the frustum
+	void QueryFrustum(const Frustum& frustum, float margin, std::vector<entt::entity>& result) const;
+	/// Append up to count entities closest to position, nearest first
+	void QueryNearest(const glm::vec3& position, std::size_t count, std::vector<entt::entity>& result) const;
+
+private:
+	struct Entry
+	{
+		entt::entity entity;
+		glm::vec3 position;
+	};
+
+	struct Location
+	{
+		uint32_t cell;
+		uint32_t index;
+	};
+
+	/// Clamped cell column or row of a world coordinate
+	[[nodiscard]] static uint16_t GetCellCoordinate(float coordinate);
+	[[nodiscard]] static uint32_t GetCellIndex(uint16_t x, uint16_t z) { return x * CellsPerSide + z; }
+	[[nodiscard]] static uint32_t GetCellIndex(const glm::vec3& position);
+
+	/// Visit every entry of the cells covering [minimum, maximum] on x and z
+	template <typename Function>
+	void ForEachEntry(float minimumX, float minimumZ, float maximumX, float maximumZ, Function function) const;
+
+	std::vector<std::vector<Entry>> _cells;
+	/// Bounds of every position stored in each cell since it was last empty, used to test cells against frusta. Edge
+	/// cells can hold positions outside of the island.
+	std::vector<AxisAlignedBoundingBox> _cellBounds;
+	std::unordered_map<entt::entity, Location> _locations;
+};
+
+} // namespace openblack::entities
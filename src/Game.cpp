@@ -39,6 +39,7 @@
 #include <spdlog/spdlog.h>
 
 #include <cstdint>
+#include <limits>
 #include <string>
 
 #ifdef WIN32
@@ -118,11 +119,6 @@ const Transform& Game::GetHandTransform() const
 	return _entityRegistry->Get<Transform>(_handEntity);
 }
 
-Transform& Game::GetHandTransform()
-{
-	return _entityRegistry->Get<Transform>(_handEntity);
-}
-
 bool Game::ProcessEvents(const SDL_Event& event)
 {
 	static bool leftMouseButton = false;
@@ -230,14 +226,22 @@ bool Game::Update()
 			_camera->DeprojectScreenToWorld(_mousePosition, screenSize, rayOrigin, rayDirection);
 
 			float intersectDistance = 0.0f;
-			bool intersects = glm::intersectRayPlane(rayOrigin, rayDirection, glm::vec3(0.0f, 0.0f, 0.0f), // plane origin
-			                                         glm::vec3(0.0f, 1.0f, 0.0f),                          // plane normal
-			                                         intersectDistance);
-
-			if (intersects)
+			if (_landIsland->RayCast(rayOrigin, rayDirection, std::numeric_limits<float>::max(), intersectDistance))
+			{
 				_intersection = rayOrigin + rayDirection * intersectDistance;
+			}
+			else
+			{
+				// off the island, fall back to the sea
+				bool intersects = glm::intersectRayPlane(rayOrigin, rayDirection, glm::vec3(0.0f, 0.0f, 0.0f), // plane origin
+				                                         glm::vec3(0.0f, 1.0f, 0.0f),                          // plane normal
+				                                         intersectDistance);
+
+				if (intersects)
+					_intersection = rayOrigin + rayDirection * intersectDistance;
 
-			_intersection.y = _landIsland->GetHeightAt(glm::vec2(_intersection.x, _intersection.z));
+				_intersection.y = _landIsland->GetHeightAt(glm::vec2(_intersection.x, _intersection.z));
+			}
 
 			_renderer->UpdateDebugCrossUniforms(_intersection, 50.0f);
 		}
@@ -246,15 +250,16 @@ bool Game::Update()
 		if (!_handGripping)
 		{
 			const glm::mat4 modelRotationCorrection = glm::eulerAngleX(glm::radians(90.0f));
-			auto& handTransform = _entityRegistry->Get<Transform>(_handEntity);
-			handTransform.position = _intersection;
-			auto cameraRotation = _camera->GetRotation();
+			_entityRegistry->Patch<Transform>(_handEntity, [this, &modelRotationCorrection](Transform& handTransform) {
+				handTransform.position = _intersection;
+				auto cameraRotation = _camera->GetRotation();
 
-			auto handHeight = GetLandIsland().GetHeightAt(glm::vec2(handTransform.position.x, handTransform.position.z)) + 4.0f;
+				auto handHeight =
+				    GetLandIsland().GetHeightAt(glm::vec2(handTransform.position.x, handTransform.position.z)) + 4.0f;
 
-			handTransform.rotation = glm::eulerAngleY(glm::radians(-cameraRotation.y)) * modelRotationCorrection;
-			handTransform.position = glm::vec3(handTransform.position.x, handHeight, handTransform.position.z);
-			_entityRegistry->Context().renderContext.dirty = true;
+				handTransform.rotation = glm::eulerAngleY(glm::radians(-cameraRotation.y)) * modelRotationCorrection;
+				handTransform.position = glm::vec3(handTransform.position.x, handHeight, handTransform.position.z);
+			});
 		}
 
 		// Update Entities
@@ -265,6 +270,12 @@ bool Game::Update()
 				_entityRegistry->PrepareDraw(_config.drawBoundingBoxes, _config.drawFootpaths, _config.drawStreams);
 			}
 		}
+
+		// Update Island
+		{
+			auto updateIsland = _profiler->BeginScoped(Profiler::Stage::UpdateIsland);
+			_landIsland->RebuildDirtyBlocks();
+		}
 	} // Update Uniforms
 
 	return _config.numFramesToSimulate == 0 || _frameCount < _config.numFramesToSimulate;
@@ -354,6 +365,8 @@ void Game::Run()
 			    /*timeOfDay =*/_config.timeOfDay,
 			    /*bumpMapStrength =*/_config.bumpMapStrength,
 			    /*smallBumpMapStrength =*/_config.smallBumpMapStrength,
+			    /*terrainLodError =*/_config.terrainLodError,
+			    /*terrainBakeDistance =*/_config.terrainBakeDistance,
 			};
 
 			_renderer->DrawScene(*_meshPack, drawDesc);
@@ -97,6 +97,10 @@ class Game
 		float timeOfDay {1.0f};
 		float bumpMapStrength {1.0f};
 		float smallBumpMapStrength {1.0f};
+		/// Largest terrain error allowed by the level of detail selection, in fractions of the screen height
+		float terrainLodError {0.002f};
+		/// Distance from the camera past which terrain blocks are drawn with their baked materials
+		float terrainBakeDistance {1000.0f};
 
 		bool bgfxDebug {false};
 		bool running {false};
@@ -132,7 +136,6 @@ class Game
 	[[nodiscard]] L3DMesh& GetTestModel() const { return *_testModel; }
 	[[nodiscard]] L3DMesh& GetHandModel() const { return *_handModel; }
 	const Transform& GetHandTransform() const;
-	Transform& GetHandTransform();
 	AnimationPack& GetAnimationPack() { return *_animationPack; }
 	MeshPack& GetMeshPack() { return *_meshPack; }
 	[[nodiscard]] const LHVM::LHVM* GetLhvm() { return _lhvm.get(); }
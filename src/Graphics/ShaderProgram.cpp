@@ -66,12 +66,12 @@ void ShaderProgram::SetTextureSampler(const char* samplerName, uint8_t bindPoint
 	}
 }
 
-void ShaderProgram::SetUniformValue(const char* uniformName, const void* value) const
+void ShaderProgram::SetUniformValue(const char* uniformName, const void* value, uint16_t count) const
 {
 	auto uniform = _uniforms.find(uniformName);
 	if (uniform != _uniforms.cend())
 	{
-		bgfx::setUniform(uniform->second, value);
+		bgfx::setUniform(uniform->second, value, count);
 	}
 	else
 	{
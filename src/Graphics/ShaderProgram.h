@@ -34,7 +34,8 @@ class ShaderProgram
 	~ShaderProgram();
 
 	void SetTextureSampler(const char* samplerName, uint8_t bindPoint, const Texture2D& texture) const;
-	void SetUniformValue(const char* uniformName, const void* value) const;
+	/// count is the number of elements to set for uniform arrays
+	void SetUniformValue(const char* uniformName, const void* value, uint16_t count = 1) const;
 
 	[[nodiscard]] bgfx::ProgramHandle GetRawHandle() const { return _program; }
 
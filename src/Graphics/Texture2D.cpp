@@ -95,7 +95,8 @@ Texture2D::~Texture2D()
 void Texture2D::Create(uint16_t width, uint16_t height, uint16_t layers, Format format, Wrapping wrapping, const void* data,
                        size_t size)
 {
-	auto memory = bgfx::makeRef(data, size);
+	// Without data the texture is left mutable so its layers can be uploaded with UpdateLayer
+	auto memory = data != nullptr ? bgfx::makeRef(data, size) : nullptr;
 	_handle = bgfx::createTexture2D(width, height, false, layers, getBgfxTextureFormat(format), BGFX_TEXTURE_NONE, memory);
 	bgfx::setName(_handle, _name.c_str());
 	bgfx::frame();
@@ -104,6 +105,22 @@ void Texture2D::Create(uint16_t width, uint16_t height, uint16_t layers, Format
 	bgfx::frame();
 }
 
+void Texture2D::UpdateLayer(uint16_t layer, const void* data, size_t size)
+{
+	assert(bgfx::isValid(_handle));
+	assert(layer < _info.numLayers);
+	bgfx::updateTexture2D(_handle, layer, 0, 0, 0, _info.width, _info.height, bgfx::makeRef(data, size));
+}
+
+void Texture2D::UpdateRegion(uint16_t layer, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const void* data,
+                             size_t size)
+{
+	assert(bgfx::isValid(_handle));
+	assert(layer < _info.numLayers);
+	assert(x + width <= _info.width && y + height <= _info.height);
+	bgfx::updateTexture2D(_handle, layer, 0, x, y, width, height, bgfx::makeRef(data, size));
+}
+
 void Texture2D::DumpTexture()
 {
 	assert(!_name.empty());
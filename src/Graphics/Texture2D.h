@@ -104,6 +104,13 @@ class Texture2D
 
 	void Create(uint16_t width, uint16_t height, uint16_t layers, Format format = Format::RGBA8,
 	            Wrapping wrapping = Wrapping::ClampEdge, const void* data = nullptr, size_t size = 0);
+	/// Upload a single layer of a texture created without data. The data is referenced, not copied, and must stay
+	/// valid until the next frame.
+	void UpdateLayer(uint16_t layer, const void* data, size_t size);
+	/// Upload a rectangle of a single layer of a texture created without data, with the same lifetime rules as
+	/// UpdateLayer. The data holds the rows of the rectangle one after the other.
+	void UpdateRegion(uint16_t layer, uint16_t x, uint16_t y, uint16_t width, uint16_t height, const void* data,
+	                  size_t size);
 
 	[[nodiscard]] const bgfx::TextureHandle& GetNativeHandle() const { return _handle; }
 	[[nodiscard]] uint16_t GetWidth() const { return _info.width; }
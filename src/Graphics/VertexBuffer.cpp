@@ -38,6 +38,7 @@ VertexBuffer::VertexBuffer(std::string name, const void* vertices, uint32_t vert
     , _vertexDecl(std::move(decl))
     , _strideBytes(0)
     , _handle(BGFX_INVALID_HANDLE)
+    , _dynamicHandle(BGFX_INVALID_HANDLE)
     , _layoutHandle(BGFX_INVALID_HANDLE)
 {
 	// assert(vertices != nullptr);
@@ -70,12 +71,13 @@ VertexBuffer::VertexBuffer(std::string name, const void* vertices, uint32_t vert
 	bgfx::setName(_handle, _name.c_str());
 }
 
-VertexBuffer::VertexBuffer(std::string name, const bgfx::Memory* mem, VertexDecl decl)
+VertexBuffer::VertexBuffer(std::string name, const bgfx::Memory* mem, VertexDecl decl, bool dynamic)
     : _name(std::move(name))
     , _vertexCount(0)
     , _vertexDecl(std::move(decl))
     , _strideBytes(0)
     , _handle(BGFX_INVALID_HANDLE)
+    , _dynamicHandle(BGFX_INVALID_HANDLE)
     , _layoutHandle(BGFX_INVALID_HANDLE)
 {
 	// assert(vertices != nullptr);
@@ -103,15 +105,24 @@ VertexBuffer::VertexBuffer(std::string name, const bgfx::Memory* mem, VertexDecl
 
 	_vertexCount = mem->size / _strideBytes;
 
-	_handle = bgfx::createVertexBuffer(mem, layout);
+	if (dynamic)
+	{
+		_dynamicHandle = bgfx::createDynamicVertexBuffer(mem, layout);
+	}
+	else
+	{
+		_handle = bgfx::createVertexBuffer(mem, layout);
+		bgfx::setName(_handle, _name.c_str());
+	}
 	_layoutHandle = bgfx::createVertexLayout(layout);
-	bgfx::setName(_handle, _name.c_str());
 }
 
 VertexBuffer::~VertexBuffer()
 {
 	if (bgfx::isValid(_handle))
 		bgfx::destroy(_handle);
+	if (bgfx::isValid(_dynamicHandle))
+		bgfx::destroy(_dynamicHandle);
 	if (bgfx::isValid(_layoutHandle))
 		bgfx::destroy(_layoutHandle);
 }
@@ -133,5 +144,25 @@ size_t VertexBuffer::GetSizeInBytes() const noexcept
 
 void VertexBuffer::Bind() const
 {
-	bgfx::setVertexBuffer(0, _handle, 0, _vertexCount, _layoutHandle);
+	Bind(_vertexCount, 0);
+}
+
+void VertexBuffer::Bind(uint32_t count, uint32_t startVertex) const
+{
+	assert(startVertex + count <= _vertexCount);
+	if (bgfx::isValid(_dynamicHandle))
+	{
+		bgfx::setVertexBuffer(0, _dynamicHandle, startVertex, count, _layoutHandle);
+	}
+	else
+	{
+		bgfx::setVertexBuffer(0, _handle, startVertex, count, _layoutHandle);
+	}
+}
+
+void VertexBuffer::Update(uint32_t startVertex, const bgfx::Memory* memory)
+{
+	assert(bgfx::isValid(_dynamicHandle));
+	assert(startVertex + memory->size / _strideBytes <= _vertexCount);
+	bgfx::update(_dynamicHandle, startVertex, memory);
 }
@@ -75,7 +75,8 @@ class VertexBuffer
 {
 public:
 	VertexBuffer(std::string name, const void* vertices, uint32_t vertexCount, VertexDecl decl);
-	VertexBuffer(std::string name, const bgfx::Memory* memory, VertexDecl decl);
+	/// A dynamic buffer can have ranges of its vertices replaced with Update
+	VertexBuffer(std::string name, const bgfx::Memory* memory, VertexDecl decl, bool dynamic = false);
 	~VertexBuffer();
 
 	[[nodiscard]] uint32_t GetCount() const noexcept;
@@ -83,6 +84,10 @@ class VertexBuffer
 	[[nodiscard]] size_t GetSizeInBytes() const noexcept;
 
 	void Bind() const;
+	void Bind(uint32_t count, uint32_t startVertex) const;
+
+	/// Replace the vertices from startVertex on with memory, only for dynamic buffers
+	void Update(uint32_t startVertex, const bgfx::Memory* memory);
 
 private:
 	std::string _name;
@@ -91,6 +96,7 @@ class VertexBuffer
 	size_t _strideBytes;
 	std::vector<const void*> _vertexDeclOffsets;
 	bgfx::VertexBufferHandle _handle;
+	bgfx::DynamicVertexBufferHandle _dynamicHandle;
 	bgfx::VertexLayoutHandle _layoutHandle;
 };
 
@@ -618,6 +618,8 @@ bool Gui::Loop(Game& game, const Renderer& renderer)
 	{
 		ImGui::SliderFloat("Bump", &config.bumpMapStrength, 0.0f, 1.0f, "%.3f");
 		ImGui::SliderFloat("Small Bump", &config.smallBumpMapStrength, 0.0f, 1.0f, "%.3f");
+		ImGui::SliderFloat("Terrain LOD Error", &config.terrainLodError, 0.0001f, 0.05f, "%.4f", 2.0f);
+		ImGui::SliderFloat("Terrain Bake Distance", &config.terrainBakeDistance, 0.0f, 5000.0f, "%.0f");
 
 		ImGui::Separator();
 
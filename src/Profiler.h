@@ -26,6 +26,7 @@ class Profiler
 		SdlInput,
 		UpdateUniforms,
 		UpdateEntities,
+		UpdateIsland,
 		GuiLoop,
 		SceneDraw,
 		ReflectionPass,
@@ -71,10 +72,10 @@ class Profiler
 	};
 
 	static constexpr std::array<std::string_view, static_cast<uint8_t>(Stage::_count)> stageNames = {
-	    "SDL Input",        "Update Uniforms",  "Entities",        "GUI Loop",       "Encode Draw Scene",
-	    "Reflection Pass",  "Draw Sky",         "Draw Water",      "Draw Island",    "Draw Models",
-	    "Draw Debug Cross", "Main Pass",        "Draw Sky",        "Draw Water",     "Draw Island",
-	    "Draw Models",      "Draw Debug Cross", "Encode GUI Draw", "Renderer Frame",
+	    "SDL Input",         "Update Uniforms",  "Entities",         "Island",          "GUI Loop",
+	    "Encode Draw Scene", "Reflection Pass",  "Draw Sky",         "Draw Water",      "Draw Island",
+	    "Draw Models",       "Draw Debug Cross", "Main Pass",        "Draw Sky",        "Draw Water",
+	    "Draw Island",       "Draw Models",      "Draw Debug Cross", "Encode GUI Draw", "Renderer Frame",
 	};
 
 	struct Entry
@@ -10,6 +10,7 @@
 #include "Renderer.h"
 
 #include "3D/Camera.h"
+#include "3D/Frustum.h"
 #include "3D/L3DAnim.h"
 #include "3D/L3DMesh.h"
 #include "3D/LandIsland.h"
@@ -32,6 +33,8 @@
 #include <glm/gtx/transform.hpp>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+
 using namespace openblack;
 using namespace openblack::graphics;
 
@@ -221,7 +224,11 @@ void Renderer::DrawSubMesh(const L3DMesh& mesh, const L3DSubMesh& subMesh, const
 		}
 
 		{
-			if (desc.instanceBuffer && (skip & Mesh::SkipState::SkipInstanceBuffer) == 0)
+			if (desc.instanceData && (skip & Mesh::SkipState::SkipInstanceBuffer) == 0)
+			{
+				bgfx::setInstanceDataBuffer(desc.instanceData, desc.instanceStart, desc.instanceCount);
+			}
+			else if (desc.instanceBuffer && (skip & Mesh::SkipState::SkipInstanceBuffer) == 0)
 			{
 				bgfx::setInstanceDataBuffer(*desc.instanceBuffer, desc.instanceStart, desc.instanceCount);
 			}
@@ -297,6 +304,8 @@ void Renderer::DrawScene(const MeshPack& meshPack, const DrawSceneDesc& drawDesc
 			drawPassDesc.drawDebugCross = false;
 			drawPassDesc.drawBoundingBoxes = false;
 			drawPassDesc.cullBack = true;
+			// the reflection is distorted by the water, coarser terrain is not noticeable
+			drawPassDesc.terrainLodError *= 4.0f;
 			DrawPass(meshPack, drawPassDesc);
 		}
 	}
@@ -323,6 +332,7 @@ void Renderer::DrawPass(const MeshPack& meshPack, const DrawSceneDesc& desc) con
 	auto objectShader = _shaderManager->GetShader("Object");
 	auto waterShader = _shaderManager->GetShader("Water");
 	auto terrainShader = _shaderManager->GetShader("Terrain");
+	auto terrainBakedShader = _shaderManager->GetShader("TerrainBaked");
 	auto debugShader = _shaderManager->GetShader("DebugLine");
 	auto debugShaderInstanced = _shaderManager->GetShader("DebugLineInstanced");
 	auto objectShaderInstanced = _shaderManager->GetShader("ObjectInstanced");
@@ -372,18 +382,31 @@ void Renderer::DrawPass(const MeshPack& meshPack, const DrawSceneDesc& desc) con
 		                                                                               : Profiler::Stage::MainPassDrawIsland);
 		if (desc.drawIsland)
 		{
-			for (auto& block : desc.island.GetBlocks())
+			const auto& blocks = desc.island.GetBlocks();
+			const Frustum frustum(desc.camera->GetViewProjectionMatrix());
+			// blocks past the bake distance are drawn with the materials LandIsland blended into its baked atlas
+			const auto eye = desc.camera->GetPosition();
+			auto& nearBlocks = _nearBlocks;
+			auto& bakedBlocks = _bakedBlocks;
+			nearBlocks.clear();
+			bakedBlocks.clear();
+			for (size_t i = 0; i < blocks.size(); i++)
 			{
-				terrainShader->SetTextureSampler("s0_materials", 0, desc.island.GetAlbedoArray());
-				terrainShader->SetTextureSampler("s1_bump", 1, desc.island.GetBump());
-				terrainShader->SetTextureSampler("s2_smallBump", 2, desc.island.GetSmallBump());
-				terrainShader->SetUniformValue("u_timeOfDay", &desc.timeOfDay);
-				terrainShader->SetUniformValue("u_bumpmapStrength", &desc.bumpMapStrength);
-				terrainShader->SetUniformValue("u_smallBumpmapStrength", &desc.smallBumpMapStrength);
+				const auto& box = blocks[i].GetBoundingBox();
+				if (frustum.Intersects(box))
+				{
+					const float distance = glm::length(glm::clamp(eye, box.minima, box.maxima) - eye);
+					(distance < desc.terrainBakeDistance ? nearBlocks : bakedBlocks).push_back(i);
+				}
+			}
 
-				glm::vec4 mapPosition = block.GetMapPosition();
-				terrainShader->SetUniformValue("u_blockPosition", &mapPosition);
+			// errors are compared in fractions of the screen height
+			auto& lods = _blockLods;
+			const float errorScale = desc.camera->GetProjectionMatrix()[1][1] * 0.5f / desc.terrainLodError;
+			desc.island.SelectLods(eye, errorScale, lods);
 
+			if (!nearBlocks.empty() || !bakedBlocks.empty())
+			{
 				// clang-format off
 				constexpr auto defaultState = 0u
 					| BGFX_STATE_WRITE_MASK
@@ -393,9 +416,102 @@ void Renderer::DrawPass(const MeshPack& meshPack, const DrawSceneDesc& desc) con
 				;
 				// clang-format on
 
-				block.GetMesh().GetVertexBuffer().Bind();
+				// State shared by all blocks is bound once and kept until the last block is submitted, both programs
+				// share the uniforms and the bump map by name
+				terrainShader->SetTextureSampler("s0_materials", 0, desc.island.GetAlbedoArray());
+				terrainShader->SetTextureSampler("s1_bump", 1, desc.island.GetBump());
+				terrainShader->SetTextureSampler("s2_smallBump", 2, desc.island.GetSmallBump());
+				terrainShader->SetTextureSampler("s3_altitudes", 3, desc.island.GetAltitudeMap());
+				terrainShader->SetTextureSampler("s4_cellProperties", 4, desc.island.GetCellPropertiesMap());
+				terrainShader->SetTextureSampler("s5_noise", 5, desc.island.GetNoiseMap());
+				terrainShader->SetTextureSampler("s6_countryLookup", 6, desc.island.GetCountryLookup());
+				terrainBakedShader->SetTextureSampler("s7_baked", 7, desc.island.GetBakedAtlas());
+				terrainShader->SetUniformValue("u_timeOfDay", &desc.timeOfDay);
+				terrainShader->SetUniformValue("u_bumpmapStrength", &desc.bumpMapStrength);
+				terrainShader->SetUniformValue("u_smallBumpmapStrength", &desc.smallBumpMapStrength);
 				bgfx::setState(defaultState | (desc.cullBack ? BGFX_STATE_CULL_CCW : BGFX_STATE_CULL_CW), 0);
-				bgfx::submit(static_cast<bgfx::ViewId>(desc.viewId), terrainShader->GetRawHandle());
+
+				// Position and stitched edges of every block, see vs_terrain
+				std::array<glm::vec4, LandIsland::MaxBlocks / 4 + 1> blockData {};
+				for (size_t i = 0; i < blocks.size(); i++)
+				{
+					const auto position = blocks[i].GetBlockPosition();
+					const auto packed = position.x + 32 * position.y + 1024 * lods[i].coarserNeighbours;
+					blockData[i / 4][i % 4] = static_cast<float>(packed);
+				}
+				terrainShader->SetUniformValue("u_blockData", blockData.data(), static_cast<uint16_t>(blockData.size()));
+
+				const auto& vertexBuffer = desc.island.GetVertexBuffer();
+				// everything bound above is discarded with the last submit of the last program
+				auto submitBlocks = [&](const std::vector<size_t>& visibleBlocks, const ShaderProgram& program,
+				                        bool lastProgram) {
+					if (visibleBlocks.empty())
+						return;
+
+					uint32_t indexCount = 0;
+					for (auto i : visibleBlocks)
+					{
+						indexCount += LandBlock::GetLodCellCount(lods[i].level) * 6;
+					}
+
+					if (bgfx::getAvailTransientIndexBuffer(indexCount) == indexCount)
+					{
+						// One submit per batch of blocks, the indices of every visible block at its level of detail are
+						// gathered relative to the first vertex of its batch
+						bgfx::TransientIndexBuffer indices;
+						bgfx::allocTransientIndexBuffer(&indices, indexCount);
+						auto* data = reinterpret_cast<uint16_t*>(indices.data);
+
+						uint32_t firstIndex = 0;
+						for (auto first = visibleBlocks.cbegin(); first != visibleBlocks.cend();)
+						{
+							const size_t batch = *first / LandIsland::BlocksPerBatch;
+							const size_t batchStart = batch * LandIsland::BlocksPerBatch;
+							const size_t batchSize = std::min<size_t>(LandIsland::BlocksPerBatch, blocks.size() - batchStart);
+
+							uint32_t batchIndexCount = 0;
+							auto last = first;
+							for (; last != visibleBlocks.cend() && *last < batchStart + batchSize; ++last)
+							{
+								const auto level = lods[*last].level;
+								const auto cellCount = LandBlock::GetLodCellCount(level);
+								const auto firstVertex =
+								    (*last - batchStart) * LandBlock::VertexCount + LandBlock::GetLodVertexOffset(level);
+								LandBlock::BuildIndexList(data + firstIndex + batchIndexCount, cellCount,
+								                          static_cast<uint16_t>(firstVertex));
+								batchIndexCount += cellCount * 6;
+							}
+
+							bgfx::setIndexBuffer(&indices, firstIndex, batchIndexCount);
+							vertexBuffer.Bind(static_cast<uint32_t>(batchSize * LandBlock::VertexCount),
+							                  static_cast<uint32_t>(batchStart * LandBlock::VertexCount));
+							const bool lastSubmit = lastProgram && last == visibleBlocks.cend();
+							bgfx::submit(static_cast<bgfx::ViewId>(desc.viewId), program.GetRawHandle(), 0,
+							             lastSubmit ? BGFX_DISCARD_ALL
+							                        : BGFX_DISCARD_VERTEX_STREAMS | BGFX_DISCARD_INDEX_BUFFER);
+							firstIndex += batchIndexCount;
+							first = last;
+						}
+					}
+					else
+					{
+						// Out of transient indices, fall back to one submit per block
+						for (auto i : visibleBlocks)
+						{
+							const auto level = lods[i].level;
+							const auto cellCount = LandBlock::GetLodCellCount(level);
+							desc.island.GetIndexBuffer().Bind(cellCount * 6);
+							const auto firstVertex = i * LandBlock::VertexCount + LandBlock::GetLodVertexOffset(level);
+							vertexBuffer.Bind(cellCount * 4, static_cast<uint32_t>(firstVertex));
+							const bool lastSubmit = lastProgram && i == visibleBlocks.back();
+							bgfx::submit(static_cast<bgfx::ViewId>(desc.viewId), program.GetRawHandle(), 0,
+							             lastSubmit ? BGFX_DISCARD_ALL
+							                        : BGFX_DISCARD_VERTEX_STREAMS | BGFX_DISCARD_INDEX_BUFFER);
+						}
+					}
+				};
+				submitBlocks(nearBlocks, *terrainShader, bakedBlocks.empty());
+				submitBlocks(bakedBlocks, *terrainBakedShader, true);
 			}
 		}
 	}
@@ -416,7 +532,15 @@ void Renderer::DrawPass(const MeshPack& meshPack, const DrawSceneDesc& desc) con
 			// clang-format on
 			auto& renderCtx = desc.entities.Context().renderContext;
 
-			// Instance meshes
+			// Cull the instances of every mesh against this view, the visible ones are gathered mesh after mesh. Boned
+			// meshes are never culled, their vertices are not in the space of the bounding box of the mesh.
+			auto& allInstances = _allInstances;
+			auto& visibleInstances = _visibleInstances;
+			auto& visibleIndices = _visibleIndices;
+			allInstances.clear();
+			visibleInstances.clear();
+			visibleIndices.clear();
+			const Frustum frustum(desc.camera->GetViewProjectionMatrix());
 			for (const auto& [meshId, placers] : renderCtx.instancedDrawDescs)
 			{
 				const L3DMesh* mesh = nullptr;
@@ -430,10 +554,45 @@ void Renderer::DrawPass(const MeshPack& meshPack, const DrawSceneDesc& desc) con
 				{
 					mesh = &meshPack.GetMesh(static_cast<uint32_t>(meshId));
 				}
+				allInstances.push_back({mesh, placers.offset, placers.count});
+
+				const auto offset = static_cast<uint32_t>(visibleIndices.size());
+				for (uint32_t i = placers.offset; i < placers.offset + placers.count; i++)
+				{
+					if (mesh->IsBoned() || frustum.Intersects(renderCtx.instanceBounds[i]))
+					{
+						visibleIndices.push_back(i);
+					}
+				}
+				const auto count = static_cast<uint32_t>(visibleIndices.size()) - offset;
+				if (count > 0)
+				{
+					visibleInstances.push_back({mesh, offset, count});
+				}
+			}
 
+			// The visible matrices are copied to transient instance data for this view. Without enough transient memory
+			// the instances are drawn from their full ranges in the instance buffer.
+			bgfx::InstanceDataBuffer instanceData;
+			const auto visibleCount = static_cast<uint32_t>(visibleIndices.size());
+			const bool culled = bgfx::getAvailInstanceDataBuffer(visibleCount, sizeof(AffineMatrix)) == visibleCount;
+			if (culled && visibleCount > 0)
+			{
+				bgfx::allocInstanceDataBuffer(&instanceData, visibleCount, sizeof(AffineMatrix));
+				auto* matrices = reinterpret_cast<AffineMatrix*>(instanceData.data);
+				for (uint32_t i = 0; i < visibleCount; i++)
+				{
+					matrices[i] = renderCtx.instanceUniforms[visibleIndices[i]];
+				}
+			}
+
+			// Instance meshes
+			for (const auto& [mesh, offset, count] : culled ? visibleInstances : allInstances)
+			{
 				submitDesc.instanceBuffer = &renderCtx.instanceUniformBuffer;
-				submitDesc.instanceStart = placers.offset;
-				submitDesc.instanceCount = placers.count;
+				submitDesc.instanceData = culled ? &instanceData : nullptr;
+				submitDesc.instanceStart = offset;
+				submitDesc.instanceCount = count;
 				if (mesh->IsBoned())
 				{
 					submitDesc.modelMatrices = mesh->GetBoneMatrices().data();
@@ -33,6 +33,7 @@ class L3DAnim;
 class L3DMesh;
 class L3DSubMesh;
 class LandIsland;
+struct LandBlockLod;
 class MeshPack;
 class Profiler;
 class Sky;
@@ -62,6 +63,7 @@ constexpr std::array Shaders {
     ShaderDefinition {"DebugLine", "vs_line", "fs_line"},
     ShaderDefinition {"DebugLineInstanced", "vs_line_instanced", "fs_line"},
     ShaderDefinition {"Terrain", "vs_terrain", "fs_terrain"},
+    ShaderDefinition {"TerrainBaked", "vs_terrain_baked", "fs_terrain_baked"},
     ShaderDefinition {"Object", "vs_object", "fs_object"},
     ShaderDefinition {"ObjectInstanced", "vs_object_instanced", "fs_object"},
     ShaderDefinition {"Water", "vs_water", "fs_water"},
@@ -109,6 +111,8 @@ class Renderer
 		float timeOfDay;
 		float bumpMapStrength;
 		float smallBumpMapStrength;
+		float terrainLodError;
+		float terrainBakeDistance;
 	};
 
 	struct L3DMeshSubmitDesc
@@ -120,6 +124,8 @@ class Renderer
 		const glm::mat4* modelMatrices;
 		uint8_t matrixCount;
 		const bgfx::DynamicVertexBufferHandle* instanceBuffer;
+		/// Used instead of instanceBuffer when set
+		const bgfx::InstanceDataBuffer* instanceData;
 		uint32_t instanceStart;
 		uint32_t instanceCount;
 	};
@@ -141,6 +147,14 @@ class Renderer
 	void Frame();
 
 private:
+	/// Instances of a mesh, a range of the instance buffer or of the culled instance data of a pass
+	struct MeshInstances
+	{
+		const L3DMesh* mesh;
+		uint32_t offset;
+		uint32_t count;
+	};
+
 	void DrawSubMesh(const L3DMesh& mesh, const L3DSubMesh& subMesh, const MeshPack& meshPack, const L3DMeshSubmitDesc& desc,
 	                 graphics::RenderPass viewId, const graphics::ShaderProgram& program, uint64_t state, uint32_t rgba,
 	                 bool preserveState) const;
@@ -151,5 +165,13 @@ class Renderer
 
 	std::unique_ptr<graphics::DebugLines> _debugCross;
 	glm::mat4 _debugCrossPosition;
+
+	/// Scratch storage of DrawPass, cleared every pass and only reallocated when the scene outgrows it
+	mutable std::vector<size_t> _nearBlocks;
+	mutable std::vector<size_t> _bakedBlocks;
+	mutable std::vector<LandBlockLod> _blockLods;
+	mutable std::vector<MeshInstances> _allInstances;
+	mutable std::vector<MeshInstances> _visibleInstances;
+	mutable std::vector<uint32_t> _visibleIndices;
 };
 } // namespace openblack